@@ -0,0 +1,212 @@
+#pragma once
+
+#include "pch.h"
+#include "ThreadPool.h"
+
+#include <coroutine>
+#include <optional>
+
+// Lazily started coroutine that produces a T. Awaiting it starts it and resumes the awaiting
+// coroutine when it is done, exceptions are passed on to the awaiting coroutine.
+template<typename T = void>
+class Task;
+
+namespace detail {
+
+	struct TaskPromiseBase {
+		std::coroutine_handle<> continuation = std::noop_coroutine();
+		std::exception_ptr exception;
+
+		struct FinalAwaiter {
+			bool await_ready() noexcept { return false; }
+			template<typename P>
+			std::coroutine_handle<> await_suspend(std::coroutine_handle<P> handle) noexcept {
+				return handle.promise().continuation;
+			}
+			void await_resume() noexcept {}
+		};
+
+		std::suspend_always initial_suspend() noexcept { return {}; }
+		FinalAwaiter final_suspend() noexcept { return {}; }
+		void unhandled_exception() { exception = std::current_exception(); }
+	};
+
+	template<typename T>
+	struct TaskPromise : TaskPromiseBase {
+		std::optional<T> value;
+
+		Task<T> get_return_object();
+		void return_value(T v) { value = std::move(v); }
+
+		T result() {
+			if (exception)
+				std::rethrow_exception(exception);
+			return std::move(*value);
+		}
+	};
+
+	template<>
+	struct TaskPromise<void> : TaskPromiseBase {
+		Task<void> get_return_object();
+		void return_void() {}
+
+		void result() {
+			if (exception)
+				std::rethrow_exception(exception);
+		}
+	};
+}
+
+template<typename T>
+class Task {
+public:
+	using promise_type = detail::TaskPromise<T>;
+
+	Task(Task&& other) noexcept : handle(std::exchange(other.handle, nullptr)) {}
+	Task(const Task&) = delete;
+
+	~Task() {
+		if (handle) {
+			handle.destroy();
+		}
+	}
+
+	bool await_ready() const noexcept {
+		return false;
+	}
+
+	std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept {
+		handle.promise().continuation = awaiting;
+		return handle;
+	}
+
+	T await_resume() {
+		return handle.promise().result();
+	}
+
+private:
+	friend struct detail::TaskPromise<T>;
+	explicit Task(std::coroutine_handle<promise_type> handle) : handle(handle) {}
+
+	std::coroutine_handle<promise_type> handle;
+};
+
+namespace detail {
+	template<typename T>
+	Task<T> TaskPromise<T>::get_return_object() {
+		return Task<T>(std::coroutine_handle<TaskPromise<T>>::from_promise(*this));
+	}
+
+	inline Task<void> TaskPromise<void>::get_return_object() {
+		return Task<void>(std::coroutine_handle<TaskPromise<void>>::from_promise(*this));
+	}
+}
+
+// Runs coroutines without dedicating a thread to any of them. Blocking device I/O is done on the
+// I/O pool and the coroutine continues on that thread afterwards, sleeps are handled by a single
+// timer thread. Any number of coroutines can be in flight at once.
+class AsyncExecutor {
+public:
+
+	AsyncExecutor(ThreadPool& pool);
+	~AsyncExecutor();
+
+	// Starts a coroutine and forgets about it, it runs on the calling thread until its first suspension
+	void spawn(Task<void> task);
+
+	// Number of spawned coroutines that did not finish yet
+	size_t running() const {
+		return activeTasks;
+	}
+
+	// Resumes the coroutine on the pool at the given runtime
+	void resumeAt(double runtime, std::coroutine_handle<> handle);
+
+	void post(std::function<void()> job) {
+		pool.submit(std::move(job));
+	}
+
+	// co_await executor.sleep(seconds);
+	auto sleep(double seconds) {
+		struct SleepOperation {
+			AsyncExecutor& executor;
+			double until;
+			bool await_ready() const { return Battery::GetRuntime() >= until; }
+			void await_suspend(std::coroutine_handle<> handle) { executor.resumeAt(until, handle); }
+			void await_resume() {}
+		};
+		return SleepOperation{ *this, Battery::GetRuntime() + seconds };
+	}
+
+	// co_await executor.io([] { return blockingCall(); }); runs the function on the pool
+	template<typename T>
+	auto io(std::function<T()> operation) {
+		struct IoOperation {
+			AsyncExecutor& executor;
+			std::function<T()> operation;
+			std::optional<T> result;
+			std::exception_ptr exception;
+
+			bool await_ready() const { return false; }
+			void await_suspend(std::coroutine_handle<> handle) {
+				executor.post([this, handle] {
+					try {
+						result = operation();
+					}
+					catch (...) {
+						exception = std::current_exception();
+					}
+					handle.resume();	// Don't touch this afterwards, the coroutine might be gone
+				});
+			}
+			T await_resume() {
+				if (exception)
+					std::rethrow_exception(exception);
+				return std::move(*result);
+			}
+		};
+		return IoOperation{ *this, std::move(operation) };
+	}
+
+	// co_await executor.all(jobs); runs the jobs in parallel on the pool and continues when all are done
+	auto all(std::vector<std::function<void()>> jobs) {
+		struct AllOperation {
+			AsyncExecutor& executor;
+			std::vector<std::function<void()>> jobs;
+			std::atomic<size_t> remaining = 0;
+
+			bool await_ready() const { return jobs.empty(); }
+			bool await_suspend(std::coroutine_handle<> handle) {
+				remaining = jobs.size() + 1;	// +1 so the last job can't resume us before all are posted
+				for (auto& job : jobs) {
+					executor.post([this, &job, handle] {
+						try {
+							job();
+						}
+						catch (const std::exception& e) {
+							LOG_ERROR("Uncaught exception in parallel job: {}", e.what());
+						}
+						if (remaining.fetch_sub(1) == 1) {
+							handle.resume();
+						}
+					});
+				}
+				return remaining.fetch_sub(1) != 1;		// Everything finished already, continue right away
+			}
+			void await_resume() {}
+		};
+		return AllOperation{ *this, std::move(jobs) };
+	}
+
+private:
+	void timerThread();
+
+	ThreadPool& pool;
+	std::atomic<size_t> activeTasks = 0;
+
+	std::multimap<double, std::coroutine_handle<>> timers;
+	std::mutex timerMutex;
+	std::condition_variable timerChanged;
+	std::thread timer;
+	bool stopTimer = false;
+};
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "pch.h"
+#include "Async.h"
+#include "ODrive.h"
+
+#define ASYNC_POLL_INTERVAL 0.02		// Seconds between two reads while waiting for a condition
+
+// Awaitable operations on one ODrive, so command sequences can be written as coroutines
+// that don't block a thread while they wait:
+//
+//     Task<void> calibrate(AsyncODrive drive) {
+//         co_await drive.write("axis0.requested_state", AXIS_STATE_FULL_CALIBRATION_SEQUENCE);
+//         bool idle = co_await drive.waitFor("axis0.current_state", [](const EndpointValue& v) {
+//             return v.toDouble() == AXIS_STATE_IDLE;
+//         }, 30.0);
+//     }
+//     backend->executor.spawn(calibrate(AsyncODrive(backend->executor, odrive)));
+class AsyncODrive {
+public:
+
+	AsyncODrive(AsyncExecutor& executor, std::shared_ptr<ODrive> odrive) : executor(executor), odrive(odrive) {}
+
+	// Resolves to an INVALID value if the endpoint does not exist or the read failed
+	auto read(const std::string& identifier) {
+		return executor.io<EndpointValue>([odrive = odrive, identifier] {
+			auto endpoint = odrive->findEndpoint(identifier);
+			if (!endpoint)
+				return EndpointValue(EndpointValueType::INVALID);
+			return odrive->readValue(*endpoint);
+		});
+	}
+
+	// The number is converted to the type of the endpoint
+	auto write(const std::string& identifier, double number) {
+		return executor.io<bool>([odrive = odrive, identifier, number] {
+			auto endpoint = odrive->findEndpoint(identifier);
+			if (!endpoint)
+				return false;
+			EndpointValue value(endpoint->type);
+			if (!value.fromDouble(number))
+				return false;
+			return odrive->writeValue(*endpoint, value);
+		});
+	}
+
+	// Inputs, trigger and outputs go out as one batch, see ODrive::call
+	auto call(const std::string& identifier, std::vector<EndpointValue> inputs = {}) {
+		return executor.io<FunctionResult>([odrive = odrive, identifier, inputs = std::move(inputs)] {
+			return odrive->call(identifier, inputs);
+		});
+	}
+
+	// Polls the endpoint until the predicate is true (returns true) or the timeout expired (returns false)
+	Task<bool> waitFor(std::string identifier, std::function<bool(const EndpointValue&)> predicate, double timeout, double interval = ASYNC_POLL_INTERVAL) {
+		double deadline = Battery::GetRuntime() + timeout;
+		while (true) {
+			EndpointValue value = co_await read(identifier);
+			if (value.type() != EndpointValueType::INVALID && predicate(value))
+				co_return true;
+
+			if (Battery::GetRuntime() >= deadline)
+				co_return false;
+
+			co_await executor.sleep(interval);
+		}
+	}
+
+	std::shared_ptr<ODrive> device() const {
+		return odrive;
+	}
+
+private:
+	AsyncExecutor& executor;
+	std::shared_ptr<ODrive> odrive;
+};
@@ -1,30 +1,56 @@
 #pragma once
 
 #include "ODrive.h"
+#include "DeviceRegistry.h"
 #include "libusbcpp.h"
 #include "Entry.h"
+#include "EntryList.h"
+#include "ChangeBus.h"
+#include "ThreadPool.h"
+#include "Async.h"
+#include "RigCalibration.h"
+#include "StreamSampler.h"
+#include "VerifiedWriter.h"
+#include "FleetPush.h"
+#include "SweepRunner.h"
+#include "TrajectoryPlayer.h"
+#include "WatchdogFeeder.h"
 
 #define USB_SCAN_INTERVAL 1.0f
-
-#define MAX_NUMBER_OF_ODRIVES 4
+#define IO_POOL_THREADS 8		// Device I/O mostly blocks on USB, this many devices are talked to at once
+#define STOP_POOL_THREADS 4		// Reserved for stopping all drives, never used for anything else
 
 #define REF std::reference_wrapper
 extern const char* DEFAULT_ENTRIES_JSON;
 
 class Backend;
+class EmulatedTransport;
 extern std::unique_ptr<Backend> backend;    // Accessible globally, allocated and deleted by BatteryApp
 
 class Backend {
 public:
 
     libusbcpp::context context;
-    std::array<std::shared_ptr<ODrive>, MAX_NUMBER_OF_ODRIVES> odrives;
-    std::shared_ptr<ODrive> temporaryDevice;
-    std::mutex temporaryDeviceMutex;
-    std::atomic<bool> deviceWaiting = false;
+    DeviceRegistry odrives;
+    std::vector<std::shared_ptr<ODrive>> newDevices;    // Probed by the USB listener, connected by handleNewDevices
+    std::vector<std::shared_ptr<EmulatedTransport>> emulatedDevices;  // Probed again by the USB listener after a reboot
+    std::mutex newDevicesMutex;       // Also guards emulatedDevices
 
-    std::vector<Entry> entries;   // Every entry is one line in the control panel
+    EntryList entries;            // Every entry is one line in the control panel
     std::map<std::string, EndpointValue> cachedEndpointValues;   // For endpoint selector, always only one odrive
+    ChangeBus changeBus;          // Entry values are published here whenever they change
+
+    ThreadPool ioPool;            // Blocking device I/O, like the per-device poll batches
+    ThreadPool cpuPool;           // CPU-bound jobs like descriptor parsing, export and analysis
+    ThreadPool stopPool;          // Idle, so a stop never waits behind other jobs
+    AsyncExecutor executor;       // Runs coroutine command sequences, their I/O goes to the ioPool
+    RigCalibration calibration;
+    StreamSampler sampler;        // High rate streaming of a few selected channels
+    VerifiedWriter verifiedWriter;
+    FleetPush fleetPush;          // One parameter set to many drives at once
+    SweepRunner sweeps;
+    TrajectoryPlayer player;      // Streams setpoint files from its own thread
+    WatchdogFeeder watchdog;      // Feeds axis watchdogs in the safety lane
 
     Backend();
     ~Backend();
@@ -32,42 +58,51 @@ public:
     void listenerThread();
     void handleNewDevices();
     void connectDevice(std::shared_ptr<ODrive> odrv);
+    void connectEmulatedDevices(int count);
 
     void addEntry(const Entry& entry);
-    void removeEntry(const std::string& fullPath);
+    void removeEntry(size_t entryID);
     void updateEntryCache();
     void importEntries(std::string path = "");
     void exportEntries(const std::string& file = "");
     void loadDefaultEntries();
 
-    void executeFunction(int odriveID, const std::string& identifier);
+    void executeFunction(int odriveID, const std::string& identifier, const std::vector<EndpointValue>& inputs = {});  // Asynchronously
+    void clearErrors(int odriveID);
+    void writeEndpointVerified(const BasicEndpoint& ep, const EndpointValue& value);  // Confirmed by a read-back, asynchronously
+    void stopAll();               // Idles every axis of every connected drive
     void odriveDisconnected(int odriveID);
 
     void updateEndpointCache(int odriveID);
     EndpointValue getCachedEndpointValue(const std::string& fullPath);
 
 
-    EndpointValue readEndpointDirect(const BasicEndpoint& ep);
+    EndpointValue readEndpointDirect(const BasicEndpoint& ep, SampleTime* time = nullptr);
     void writeEndpointDirect(const BasicEndpoint& ep, const EndpointValue& value);
 
     template<typename T>
     bool readEndpointDirectRaw(const BasicEndpoint& ep, T* value_ptr) {
-        if (!odrives[ep.odriveID])
+        auto odrive = odrives.get(ep.odriveID);
+        if (!odrive)
             return false;
 
-        return odrives[ep.odriveID]->read<T>(ep.identifier, value_ptr);
+        return odrive->read<T>(ep.identifier, value_ptr);
     }
 
     template<typename T>
     void writeEndpointDirectRaw(const BasicEndpoint& ep, T value) {
-        if (!odrives[ep.odriveID])
+        auto odrive = odrives.get(ep.odriveID);
+        if (!odrive)
             return;
 
-        odrives[ep.odriveID]->write<T>(ep.identifier, value);
+        odrive->write<T>(ep.identifier, value);
         LOG_DEBUG("Writing {} to endpoint {}", value, ep.fullPath);
     }
 
 private:
+    void writesVerified(const std::vector<WriteVerification>& results);
+    void publishReadBack(const std::vector<ValueChange>& samples);
+
     std::thread usbListener;
     std::atomic<bool> stopListener = false;
 };
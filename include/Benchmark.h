@@ -0,0 +1,9 @@
+#pragma once
+
+#include "pch.h"
+
+#define BENCHMARK_POLL_PASSES 20
+
+// Polls an increasing number of emulated devices the same way the entry poller does
+// and logs how the time per poll pass scales with the number of devices
+void RunScalingBenchmark(int maxDevices);
@@ -0,0 +1,150 @@
+#pragma once
+
+#include "pch.h"
+#include "config.h"
+#include "Backend.h"
+#include "FrequencyResponse.h"
+
+#include <future>
+
+#define BODE_PLOT_HEIGHT 180
+#define BODE_MIN_COHERENCE 0.8		// Points below are drawn dimmed
+
+// Graph panel tab for frequency response measurements, shown as a Bode diagram
+class BodeTab {
+
+	int odriveSelected = 0;
+	int axis = 0;
+	int input = 0;		// 0 velocity, 1 torque
+	int signal = 0;		// 0 chirp, 1 multisine
+	float amplitude = 0.5f;
+	float frequencies[2] = { 1.f, 100.f };
+	float duration = 10.f;
+	float rate = BODE_DEFAULT_RATE;
+
+	std::future<BodeResult> pending;
+	BodeResult lastResult;
+
+public:
+
+	void draw() {
+		drawSettings();
+		ImGui::Separator();
+		drawResult();
+	}
+
+private:
+	void drawSettings() {
+		ImGui::PushItemWidth(150);
+		if (ImGui::BeginCombo("Device##bode", ("odrv" + std::to_string(odriveSelected)).c_str())) {
+			for (auto& odrive : backend->odrives.list()) {
+				if (ImGui::Selectable(("odrv" + std::to_string(odrive->odriveID)).c_str(), odrive->odriveID == odriveSelected)) {
+					odriveSelected = odrive->odriveID;
+				}
+			}
+			ImGui::EndCombo();
+		}
+		ImGui::SameLine();
+		ImGui::RadioButton("axis0##bode", axis == 0) ? axis = 0 : 0;
+		ImGui::SameLine();
+		ImGui::RadioButton("axis1##bode", axis == 1) ? axis = 1 : 0;
+		ImGui::RadioButton("input_vel", input == 0) ? input = 0 : 0;
+		ImGui::SameLine();
+		ImGui::RadioButton("input_torque", input == 1) ? input = 1 : 0;
+		ImGui::RadioButton("Chirp", signal == 0) ? signal = 0 : 0;
+		ImGui::SameLine();
+		ImGui::RadioButton("Multisine", signal == 1) ? signal = 1 : 0;
+		ImGui::InputFloat("Amplitude##bode", &amplitude);
+		ImGui::InputFloat2("Frequencies [Hz]", frequencies);
+		ImGui::InputFloat("Duration [s]##bode", &duration);
+		ImGui::InputFloat("Update rate [Hz]", &rate);
+		ImGui::PopItemWidth();
+
+		if (pending.valid()) {
+			if (pending.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+				lastResult = pending.get();
+			}
+			else {
+				ImGui::TextColored(YELLOW, "Measuring...");
+				return;
+			}
+		}
+
+		auto odrive = backend->odrives.get(odriveSelected);
+		if (ImGui::Button("Measure") && odrive) {
+			BodeSettings settings;
+			settings.axis = axis;
+			settings.input = input == 0 ? ExcitationInput::VELOCITY : ExcitationInput::TORQUE;
+			settings.signal = signal == 0 ? ExcitationSignal::CHIRP : ExcitationSignal::MULTISINE;
+			settings.amplitude = amplitude;
+			settings.startFrequency = frequencies[0];
+			settings.endFrequency = frequencies[1];
+			settings.duration = duration;
+			settings.rate = rate;
+			pending = backend->ioPool.async([odrive, settings] {
+				return FrequencyResponse::Run(odrive, settings);
+			});
+		}
+	}
+
+	void drawResult() {
+		if (!lastResult.error.empty()) {
+			ImGui::TextColored(RED, "%s", lastResult.error.c_str());
+		}
+		if (!lastResult.success)
+			return;
+
+		ImGui::Text("%zu samples in %.2f s, %zu late, %zu failed", lastResult.samples, lastResult.duration, lastResult.late, lastResult.failed);
+		ImGui::Text("Magnitude [dB]");
+		drawPlot([](const BodePoint& p) { return p.magnitude; });
+		ImGui::Text("Phase [deg]");
+		drawPlot([](const BodePoint& p) { return p.phase; });
+	}
+
+	// Logarithmic frequency axis with a grid line at every decade
+	template<typename F>
+	void drawPlot(F value) {
+		auto& points = lastResult.points;
+		if (points.size() < 2)
+			return;
+
+		double low = INFINITY;
+		double high = -INFINITY;
+		for (auto& p : points) {
+			low = std::min(low, value(p));
+			high = std::max(high, value(p));
+		}
+		if (high - low < 1.0) {
+			high += 0.5;
+			low -= 0.5;
+		}
+
+		ImVec2 origin = ImGui::GetCursorScreenPos();
+		float width = ImGui::GetContentRegionAvail().x;
+		float height = BODE_PLOT_HEIGHT;
+		double logMin = std::log10(points.front().frequency);
+		double logMax = std::log10(points.back().frequency);
+		auto position = [&](double frequency, double v) {
+			return ImVec2(origin.x + (float)((std::log10(frequency) - logMin) / (logMax - logMin)) * width,
+				origin.y + height - (float)((v - low) / (high - low)) * height);
+		};
+
+		ImDrawList* drawList = ImGui::GetWindowDrawList();
+		ImU32 grid = ImGui::ColorConvertFloat4ToU32({ 0.4f, 0.4f, 0.4f, 1.f });
+		drawList->AddRect(origin, { origin.x + width, origin.y + height }, grid);
+		for (double decade = std::pow(10.0, std::ceil(logMin)); decade <= points.back().frequency; decade *= 10.0) {
+			drawList->AddLine(position(decade, low), position(decade, high), grid);
+			drawList->AddText(position(decade, low), grid, fmt::format("{:g} Hz", decade).c_str());
+		}
+
+		ImU32 good = ImGui::ColorConvertFloat4ToU32(GREEN);
+		ImU32 noisy = ImGui::ColorConvertFloat4ToU32({ 0.4f, 0.6f, 0.4f, 0.5f });
+		for (size_t i = 1; i < points.size(); i++) {
+			bool coherent = points[i].coherence >= BODE_MIN_COHERENCE && points[i - 1].coherence >= BODE_MIN_COHERENCE;
+			drawList->AddLine(position(points[i - 1].frequency, value(points[i - 1])), position(points[i].frequency, value(points[i])),
+				coherent ? good : noisy, 2.f);
+		}
+
+		ImGui::Dummy({ width, height });
+	}
+};
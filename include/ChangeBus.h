@@ -0,0 +1,66 @@
+#pragma once
+
+#include "pch.h"
+#include "Endpoint.h"
+#include "LockFreeQueue.h"
+#include "SampleTime.h"
+
+#include <unordered_map>
+
+#define CHANGE_BUS_QUEUE_SIZE 4096
+
+struct ValueChange {
+	EndpointHandle handle = 0;
+	EndpointValue value;
+	SampleTime time;			// When the new value was read
+};
+
+// Distributes endpoint value changes from the poller to any number of consumers.
+// The publisher only forwards values that differ from the last published value,
+// so a quiet system pushes nothing. Every subscriber has its own lock-free queue
+// and drains it in batches whenever it likes, without ever touching the USB.
+class ChangeBus {
+public:
+
+	class Subscriber {
+	public:
+		Subscriber(size_t capacity) : queue(capacity) {}
+
+		// Appends all pending changes to the vector, returns the number of changes appended
+		size_t poll(std::vector<ValueChange>& changes) {
+			size_t count = 0;
+			ValueChange change;
+			while (queue.pop(change)) {
+				changes.push_back(change);
+				count++;
+			}
+			return count;
+		}
+
+		size_t droppedChanges() const {
+			return dropped;
+		}
+
+	private:
+		friend class ChangeBus;
+		SPSCQueue<ValueChange> queue;
+		std::atomic<size_t> dropped = 0;
+	};
+
+	ChangeBus() = default;
+
+	std::shared_ptr<Subscriber> subscribe(size_t capacity = CHANGE_BUS_QUEUE_SIZE);
+	void unsubscribe(const std::shared_ptr<Subscriber>& subscriber);
+
+	// Takes a batch of freshly read values and publishes those that changed, returns the number of changes
+	size_t publish(const std::vector<ValueChange>& samples);
+
+	// Forget the last known values of a device, so everything is published again after a reconnect
+	void resetDevice(int odriveID);
+
+private:
+	std::mutex publisherMutex;		// Serializes publishers, subscribers never lock
+	std::unordered_map<EndpointHandle, ValueChange> lastValues;		// With the time the value was first read
+	std::vector<std::shared_ptr<Subscriber>> subscribers;
+	std::vector<ValueChange> changes;
+};
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "pch.h"
+#include "ODrive.h"
+#include "RequestBatch.h"
+
+// Captured samples with one column per channel, so analysis runs over contiguous arrays
+struct CaptureColumns {
+	std::vector<double> timestamps;				// Estimated runtime when the device sampled each batch
+	std::vector<double> sent;					// When the batch read went out
+	std::vector<double> received;				// When its last response arrived
+	std::vector<std::vector<double>> values;	// One column per channel
+
+	size_t size() const {
+		return timestamps.size();
+	}
+
+	void clear() {
+		timestamps.clear();
+		sent.clear();
+		received.clear();
+		for (auto& column : values) {
+			column.clear();
+		}
+	}
+};
+
+// Reads a few channels of one device in the calling thread for a fixed time. Used by measurements
+// which need a short burst of samples right away, instead of a continuous stream like the
+// StreamSampler. All channels go out as one pre-encoded batch read per sample.
+class ChannelCapture {
+public:
+
+	// Identifiers that don't exist or are no values make the capture invalid
+	ChannelCapture(std::shared_ptr<ODrive> odrive, const std::vector<std::string>& identifiers);
+
+	bool valid() const {
+		return odrive && !batch.empty() && batch.size() == identifiers.size();
+	}
+
+	const std::vector<std::string>& channels() const {
+		return identifiers;
+	}
+
+	// A rate of 0 reads as fast as possible. The samples are appended to the columns.
+	// Returns false if the device stopped answering.
+	bool run(double duration, double rate, CaptureColumns& columns, const std::atomic<bool>* abort = nullptr);
+
+	uint64_t failed = 0;		// Batch reads without a complete response
+
+private:
+	std::shared_ptr<ODrive> odrive;
+	std::vector<std::string> identifiers;
+	RequestBatch batch;
+};
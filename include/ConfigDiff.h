@@ -0,0 +1,32 @@
+#pragma once
+
+#include "pch.h"
+#include "ConfigSnapshot.h"
+#include "DeviceRegistry.h"
+#include "ThreadPool.h"
+
+// Compares the configuration of several devices or snapshots side by side. Snapshots only know
+// endpoint ids, they are translated to identifiers with any connected device running the same
+// firmware, so devices with different firmware are still aligned by identifier.
+struct ConfigDiff {
+
+	struct Column {
+		std::string label;
+		ConfigSnapshot snapshot;
+	};
+
+	struct Row {
+		std::string identifier;
+		std::vector<EndpointValue> values;		// One per column, INVALID if the column doesn't have it
+	};
+
+	std::vector<std::string> labels;
+	std::vector<Row> rows;			// Only the identifiers that differ, sorted
+	size_t compared = 0;			// Identifiers looked at
+	double duration = 0.0;
+
+	// Captures all devices at once, each on its own I/O job. Devices that fail are left out.
+	static std::vector<Column> CaptureDevices(const DeviceRegistry& registry, const std::vector<int>& odriveIDs, ThreadPool& pool);
+
+	static ConfigDiff Compare(const std::vector<Column>& columns, const DeviceRegistry& registry);
+};
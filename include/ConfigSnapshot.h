@@ -0,0 +1,50 @@
+#pragma once
+
+#include "pch.h"
+#include "ODrive.h"
+#include "ConfigTransaction.h"
+
+#define CONFIG_SNAPSHOT_MAGIC 0x5343444F		// "ODCS"
+#define CONFIG_SNAPSHOT_VERSION 1
+
+// The configuration of one device: every writable endpoint below a "config" object. Setpoints,
+// requested states and error flags are writable too, but restoring them would move the motor
+// or hide errors, so they are not part of it.
+//
+// Values are stored by endpoint id, which is only meaningful together with the JSON CRC, so a
+// snapshot can only be compared with or restored to a device running the same firmware.
+struct ConfigSnapshot {
+
+	uint64_t serialNumber = 0;
+	uint16_t jsonCRC = 0;
+	int64_t created = 0;		// Unix time
+	std::vector<std::pair<uint16_t, EndpointValue>> values;		// Sorted by endpoint id
+
+	struct RestoreResult {
+		bool success = false;
+		size_t total = 0;			// Parameters in the snapshot
+		size_t differing = 0;		// Parameters that had to be written
+		double duration = 0.0;
+		ConfigTransaction::Result transaction;
+	};
+
+	static bool IsConfiguration(const BasicEndpoint& endpoint);
+
+	// Reads the whole configuration with one batched transfer
+	static std::optional<ConfigSnapshot> Capture(ODrive& odrive);
+
+	// Reads the live configuration and only writes the parameters that differ
+	RestoreResult restore(ODrive& odrive, bool save) const;
+
+	EndpointValue find(uint16_t id) const;
+
+	// Binary format: header, then per value the endpoint id, the type and the value in 8 bytes
+	buffer_t serialize() const;
+	static std::optional<ConfigSnapshot> Deserialize(const buffer_t& data);
+
+	bool save(const std::string& path) const;
+	static std::optional<ConfigSnapshot> Load(const std::string& path);
+
+	// Where the snapshot of a device is kept by default, one per serial number and JSON CRC
+	static std::string DefaultPath(uint64_t serialNumber, uint16_t jsonCRC);
+};
@@ -0,0 +1,352 @@
+#pragma once
+
+#include "pch.h"
+#include "config.h"
+#include "Backend.h"
+#include "ConfigTransaction.h"
+#include "ConfigSnapshot.h"
+#include "ConfigDiff.h"
+
+#include <future>
+#include <set>
+
+// Tuning parameters that are usually changed together
+static const char* TUNING_PARAMETERS[] = {
+	"controller.config.pos_gain",
+	"controller.config.vel_gain",
+	"controller.config.vel_integrator_gain",
+	"controller.config.vel_limit",
+	"motor.config.current_lim",
+};
+
+// Graph panel tab for changing the configuration of drives
+class ConfigTab {
+
+	int odriveSelected = 0;
+	int axis = 0;
+	std::array<std::array<char, IMGUI_BUFFER_SIZE + 1>, std::size(TUNING_PARAMETERS)> tuningValues = {};
+	std::future<ConfigTransaction::Result> pendingTransaction;
+	std::future<std::vector<std::string>> pendingTuningRead;		// Current values, empty if unknown
+	ConfigTransaction::Result lastTransaction;
+	std::future<std::string> pendingBackup;		// Status message of a backup or restore
+	std::string backupStatus;
+	std::set<int> devicesSelected;		// For pushing and comparing
+	bool fleetReboot = false;
+	bool compareBackups = false;
+	std::future<ConfigDiff> pendingDiff;
+	ConfigDiff lastDiff;
+
+public:
+
+	void draw() {
+		drawDeviceSelector();
+		ImGui::Separator();
+		drawTuningSet();
+		ImGui::Separator();
+		drawBackup();
+		ImGui::Separator();
+		drawFleetPush();
+		ImGui::Separator();
+		drawDiff();
+	}
+
+private:
+	void drawDeviceSelector() {
+		auto odrives = backend->odrives.list();
+		std::string preview = "odrv" + std::to_string(odriveSelected);
+		ImGui::PushItemWidth(150);
+		if (ImGui::BeginCombo("Device", preview.c_str())) {
+			for (auto& odrive : odrives) {
+				if (ImGui::Selectable(("odrv" + std::to_string(odrive->odriveID)).c_str(), odrive->odriveID == odriveSelected)) {
+					odriveSelected = odrive->odriveID;
+				}
+			}
+			ImGui::EndCombo();
+		}
+		ImGui::PopItemWidth();
+		ImGui::SameLine();
+		ImGui::RadioButton("axis0##config", axis == 0) ? axis = 0 : 0;
+		ImGui::SameLine();
+		ImGui::RadioButton("axis1##config", axis == 1) ? axis = 1 : 0;
+	}
+
+	std::string tuningIdentifier(size_t i) const {
+		return "axis" + std::to_string(axis) + "." + TUNING_PARAMETERS[i];
+	}
+
+	void drawTuningSet() {
+		auto odrive = backend->odrives.get(odriveSelected);
+		if (!odrive) {
+			ImGui::Text("No device");
+			return;
+		}
+
+		ImGui::Text("Tuning set, applied in one burst");
+		for (size_t i = 0; i < std::size(TUNING_PARAMETERS); i++) {
+			ImGui::PushItemWidth(150);
+			ImGui::InputText(tuningIdentifier(i).c_str(), tuningValues[i].data(), IMGUI_BUFFER_SIZE, IMGUI_FLAGS_FLOAT);
+			ImGui::PopItemWidth();
+		}
+
+		bool busy = pendingTransaction.valid();
+		if (busy && pendingTransaction.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+			lastTransaction = pendingTransaction.get();
+			busy = false;
+		}
+
+		if (pendingTuningRead.valid() && pendingTuningRead.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+			std::vector<std::string> values = pendingTuningRead.get();
+			for (size_t i = 0; i < values.size(); i++) {
+				if (!values[i].empty()) {
+					strncpy_s(tuningValues[i].data(), tuningValues[i].size(), values[i].c_str(), IMGUI_BUFFER_SIZE);
+				}
+			}
+		}
+
+		if (busy) {
+			ImGui::TextColored(YELLOW, "Applying...");
+		}
+		else if (pendingTuningRead.valid()) {
+			ImGui::TextColored(YELLOW, "Reading...");
+		}
+		else {
+			if (ImGui::Button("Read current")) {
+				readTuningSet(odrive);
+			}
+			ImGui::SameLine();
+			bool apply = ImGui::Button("Apply");
+			ImGui::SameLine();
+			bool applyAndSave = ImGui::Button("Apply and save");
+			if (apply || applyAndSave) {
+				applyTuningSet(odrive, applyAndSave);
+			}
+		}
+
+		drawTransactionResult(lastTransaction);
+	}
+
+	std::optional<ConfigTransaction> tuningTransaction() const {
+		ConfigTransaction transaction;
+		for (size_t i = 0; i < std::size(TUNING_PARAMETERS); i++) {
+			std::string text = tuningValues[i].data();
+			if (text.empty())
+				continue;
+
+			EndpointValue value(EndpointValueType::FLOAT);
+			if (!value.fromString(text)) {
+				LOG_ERROR("'{}' is not a number, {} not applied", text, tuningIdentifier(i));
+				return std::nullopt;
+			}
+			transaction.set(tuningIdentifier(i), value);
+		}
+		return transaction;
+	}
+
+	// In one batch on the I/O pool, the values are filled in once they arrive
+	void readTuningSet(std::shared_ptr<ODrive> odrive) {
+		std::vector<std::string> identifiers;
+		for (size_t i = 0; i < std::size(TUNING_PARAMETERS); i++) {
+			identifiers.push_back(tuningIdentifier(i));
+		}
+
+		pendingTuningRead = backend->ioPool.async([odrive, identifiers] {
+			TransferPriorityScope priority(TransferPriority::INTERACTIVE);
+			RequestBatch batch;
+			std::vector<std::pair<size_t, size_t>> reads;		// Parameter, request index
+			for (size_t i = 0; i < identifiers.size(); i++) {
+				auto endpoint = odrive->findEndpoint(identifiers[i]);
+				if (endpoint) {
+					reads.emplace_back(i, batch.addRead(*endpoint));
+				}
+			}
+
+			std::vector<std::string> values(identifiers.size());
+			odrive->transact(batch);
+			for (auto& [i, request] : reads) {
+				if (batch.results[request].type() != EndpointValueType::INVALID) {
+					values[i] = batch.results[request].toString();
+				}
+			}
+			return values;
+		});
+	}
+
+	void applyTuningSet(std::shared_ptr<ODrive> odrive, bool save) {
+		auto transaction = tuningTransaction();
+		if (!transaction)
+			return;
+		transaction->save(save);
+
+		pendingTransaction = backend->ioPool.async([odrive, transaction = *transaction] {
+			TransferPriorityScope priority(TransferPriority::INTERACTIVE);
+			return transaction.commit(*odrive);
+		});
+	}
+
+	void drawBackup() {
+		auto odrive = backend->odrives.get(odriveSelected);
+		if (!odrive)
+			return;
+
+		ImGui::Text("Configuration backup");
+		std::string path = ConfigSnapshot::DefaultPath(odrive->serialNumber, odrive->jsonCRC);
+
+		if (pendingBackup.valid()) {
+			if (pendingBackup.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+				backupStatus = pendingBackup.get();
+			}
+			else {
+				ImGui::TextColored(YELLOW, "Working...");
+				return;
+			}
+		}
+
+		if (ImGui::Button("Backup")) {
+			pendingBackup = backend->ioPool.async([odrive, path] {
+				TransferPriorityScope priority(TransferPriority::BACKGROUND);
+				double start = Battery::GetRuntime();
+				auto snapshot = ConfigSnapshot::Capture(*odrive);
+				if (!snapshot || !snapshot->save(path))
+					return std::string("Backup failed");
+				return fmt::format("Backed up {} parameters in {:.1f} ms", snapshot->values.size(), (Battery::GetRuntime() - start) * 1000.0);
+			});
+		}
+		ImGui::SameLine();
+		bool restore = ImGui::Button("Restore");
+		ImGui::SameLine();
+		bool restoreAndSave = ImGui::Button("Restore and save");
+		if (restore || restoreAndSave) {
+			pendingBackup = backend->ioPool.async([odrive, path, save = restoreAndSave] {
+				TransferPriorityScope priority(TransferPriority::INTERACTIVE);
+				auto snapshot = ConfigSnapshot::Load(path);
+				if (!snapshot)
+					return std::string("No backup of this device");
+				auto result = snapshot->restore(*odrive, save);
+				if (!result.success)
+					return fmt::format("Restore failed after {:.1f} ms", result.duration * 1000.0);
+				return fmt::format("Restored {} of {} parameters in {:.1f} ms", result.differing, result.total, result.duration * 1000.0);
+			});
+		}
+
+		ImGui::TextDisabled("%s", path.c_str());
+		if (!backupStatus.empty()) {
+			ImGui::Text("%s", backupStatus.c_str());
+		}
+	}
+
+	void drawFleetPush() {
+		ImGui::Text("Push the tuning set to the selected drives at once");
+		for (auto& odrive : backend->odrives.list()) {
+			bool selected = devicesSelected.count(odrive->odriveID) > 0;
+			if (ImGui::Checkbox(("odrv" + std::to_string(odrive->odriveID) + "##fleet").c_str(), &selected)) {
+				selected ? (void)devicesSelected.insert(odrive->odriveID) : (void)devicesSelected.erase(odrive->odriveID);
+			}
+			ImGui::SameLine();
+		}
+		ImGui::Checkbox("Reboot after saving", &fleetReboot);
+
+		if (backend->fleetPush.running()) {
+			ImGui::TextColored(YELLOW, "Pushing...");
+		}
+		else {
+			bool push = ImGui::Button("Push");
+			ImGui::SameLine();
+			bool pushAndSave = ImGui::Button("Push and save");
+			if ((push || pushAndSave) && !devicesSelected.empty()) {
+				auto transaction = tuningTransaction();
+				if (transaction) {
+					std::vector<int> ids(devicesSelected.begin(), devicesSelected.end());
+					backend->fleetPush.start(ids, *transaction, {}, pushAndSave, pushAndSave && fleetReboot);
+				}
+			}
+		}
+
+		for (auto& device : backend->fleetPush.progress()) {
+			ImVec4 color = device.stage == FleetPush::Stage::DONE ? GREEN : (device.stage == FleetPush::Stage::FAILED ? RED : YELLOW);
+			ImGui::Text("odrv%d", device.odriveID);
+			ImGui::SameLine();
+			ImGui::TextColored(color, "%s", FleetPush::StageName(device.stage));
+			ImGui::SameLine();
+			ImGui::Text("%.1f ms %s", device.duration * 1000.0, device.message.c_str());
+		}
+	}
+
+	void drawDiff() {
+		ImGui::Text("Compare the configuration of the selected drives");
+		ImGui::Checkbox("Include backups", &compareBackups);
+
+		if (pendingDiff.valid()) {
+			if (pendingDiff.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+				lastDiff = pendingDiff.get();
+			}
+			else {
+				ImGui::TextColored(YELLOW, "Comparing...");
+				return;
+			}
+		}
+
+		if (ImGui::Button("Compare") && !devicesSelected.empty()) {
+			std::vector<int> ids(devicesSelected.begin(), devicesSelected.end());
+			pendingDiff = backend->cpuPool.async([ids, backups = compareBackups] {
+				double start = Battery::GetRuntime();
+				auto columns = ConfigDiff::CaptureDevices(backend->odrives, ids, backend->ioPool);
+				if (backups) {
+					for (int id : ids) {
+						auto odrive = backend->odrives.get(id);
+						auto snapshot = odrive ? ConfigSnapshot::Load(ConfigSnapshot::DefaultPath(odrive->serialNumber, odrive->jsonCRC)) : std::nullopt;
+						if (snapshot) {
+							columns.push_back({ "odrv" + std::to_string(id) + " backup", std::move(*snapshot) });
+						}
+					}
+				}
+				ConfigDiff diff = ConfigDiff::Compare(columns, backend->odrives);
+				diff.duration = Battery::GetRuntime() - start;
+				return diff;
+			});
+		}
+
+		if (lastDiff.labels.empty())
+			return;
+
+		ImGui::Text("%zu of %zu parameters differ, compared in %.1f ms", lastDiff.rows.size(), lastDiff.compared, lastDiff.duration * 1000.0);
+		ImGui::Columns((int)lastDiff.labels.size() + 1, "ConfigDiff");
+		ImGui::Text("Parameter");
+		ImGui::NextColumn();
+		for (auto& label : lastDiff.labels) {
+			ImGui::Text("%s", label.c_str());
+			ImGui::NextColumn();
+		}
+		ImGui::Separator();
+		for (auto& row : lastDiff.rows) {
+			ImGui::Text("%s", row.identifier.c_str());
+			ImGui::NextColumn();
+			for (auto& value : row.values) {
+				if (value.type() == EndpointValueType::INVALID) {
+					ImGui::TextColored(RED, "-");
+				}
+				else {
+					ImGui::Text("%s", value.toString().c_str());
+				}
+				ImGui::NextColumn();
+			}
+		}
+		ImGui::Columns(1);
+	}
+
+	static void drawTransactionResult(const ConfigTransaction::Result& result) {
+		if (result.items.empty())
+			return;
+
+		ImGui::TextColored(result.success ? GREEN : RED, "%s in %.1f ms", result.success ? (result.saved ? "Applied and saved" : "Applied") : "Failed", result.duration * 1000.0);
+		for (auto& item : result.items) {
+			ImVec4 color = item.status == ConfigTransaction::ItemStatus::OK ? GREEN : RED;
+			ImGui::Text("%s = %s", item.identifier.c_str(), item.written.toString().c_str());
+			ImGui::SameLine();
+			ImGui::TextColored(color, "%s", ConfigTransaction::StatusName(item.status));
+			if (item.status == ConfigTransaction::ItemStatus::MISMATCH) {
+				ImGui::SameLine();
+				ImGui::Text("(reads %s)", item.readBack.toString().c_str());
+			}
+		}
+	}
+};
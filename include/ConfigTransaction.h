@@ -0,0 +1,90 @@
+#pragma once
+
+#include "pch.h"
+#include "ODrive.h"
+
+// Changes several parameters of one device together. All items are validated against the
+// JSON definition first and nothing is sent if any of them is invalid. The writes then go out
+// back to back in one burst, followed by a read-back of every item, so the axis spends as
+// little time as possible with half of a parameter set applied.
+//
+//     auto result = ConfigTransaction()
+//         .set("axis0.controller.config.pos_gain", 30.f)
+//         .set("axis0.controller.config.vel_gain", 0.2f)
+//         .save()
+//         .commit(*odrive);
+class ConfigTransaction {
+public:
+
+	enum class ItemStatus {
+		OK,
+		NOT_SENT,			// Another item was invalid
+		UNKNOWN_ENDPOINT,
+		NOT_WRITABLE,		// Read-only, a function or an object
+		INVALID_VALUE,		// The value does not fit into the type of the endpoint
+		MISMATCH,			// The read-back differs from the written value
+		NO_READ_BACK
+	};
+
+	struct ItemResult {
+		std::string identifier;
+		EndpointValue written;		// Converted to the type of the endpoint
+		EndpointValue readBack;
+		ItemStatus status = ItemStatus::NOT_SENT;
+	};
+
+	struct Result {
+		bool success = false;		// Every item is OK, and saved if requested
+		bool saved = false;
+		double duration = 0.0;
+		std::vector<ItemResult> items;
+	};
+
+	ConfigTransaction& set(const std::string& identifier, const EndpointValue& value) {
+		items.push_back({ identifier, value });
+		return *this;
+	}
+
+	// Items of the other transaction replace items with the same identifier, the rest is appended
+	ConfigTransaction& merge(const ConfigTransaction& other) {
+		for (auto& item : other.items) {
+			auto it = std::find_if(items.begin(), items.end(), [&](const Item& i) { return i.identifier == item.identifier; });
+			if (it != items.end()) {
+				it->value = item.value;
+			}
+			else {
+				items.push_back(item);
+			}
+		}
+		return *this;
+	}
+
+	// Call save_configuration after all items were verified
+	ConfigTransaction& save(bool save = true) {
+		saveConfiguration = save;
+		return *this;
+	}
+
+	bool empty() const {
+		return items.empty();
+	}
+
+	size_t size() const {
+		return items.size();
+	}
+
+	Result commit(ODrive& odrive) const;
+
+	static const char* StatusName(ItemStatus status);
+
+private:
+	struct Item {
+		std::string identifier;
+		EndpointValue value;
+	};
+
+	static ItemStatus validate(const BasicEndpoint* endpoint, const EndpointValue& value, EndpointValue& converted);
+
+	std::vector<Item> items;
+	bool saveConfiguration = false;
+};
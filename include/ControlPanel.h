@@ -23,9 +23,19 @@ class ControlPanel : public Battery::ImGuiPanel<> {
 
 	std::map<int, char[IMGUI_BUFFER_SIZE + 1]> buffers;
 
+	std::shared_ptr<ChangeBus::Subscriber> changes;
+	std::vector<ValueChange> changeBatch;
+	std::unordered_map<EndpointHandle, double> changeTimes;		// When each value changed last
+
 public:
 	ControlPanel() : Battery::ImGuiPanel<>("ControlPanel", { 0, 0 }, { 400, 0 }) {
+		changes = backend->changeBus.subscribe();
+	}
 
+	~ControlPanel() {
+		if (backend) {
+			backend->changeBus.unsubscribe(changes);
+		}
 	}
 
 	void OnUpdate() override {
@@ -52,16 +62,17 @@ public:
 		}
 		ImGui::Separator();
 
-		std::string toRemove;
-		for (Entry& e : backend->entries) {
-			e.draw();
-			if (e.toBeRemoved) {
-				toRemove = e.endpoint->fullPath;
-			}
+		changeBatch.clear();
+		changes->poll(changeBatch);
+		for (const ValueChange& change : changeBatch) {
+			changeTimes[change.handle] = change.time.received;
 		}
 
-		if (toRemove.length() > 0) {
-			backend->removeEntry(toRemove);
+		for (auto& e : backend->entries.list()) {
+			e->draw(changeTimes);
+			if (e->toBeRemoved) {
+				backend->removeEntry(e->entryID);
+			}
 		}
 
 		ImGui::PopFont();
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "pch.h"
+#include "ODrive.h"
+#include "Rcu.h"
+
+#include <unordered_map>
+
+// Keeps track of every ODrive ever connected in this session. A device keeps the numeric ID
+// it got when its serial number was first seen, so odrvN stays the same across reconnects.
+// IDs are handed out densely, so lookup is a plain index and iteration never sees empty slots.
+//
+// The registry is published as immutable snapshots: the render thread, the poller and anything
+// else reading devices never lock, while connecting a device builds and publishes a new snapshot.
+class DeviceRegistry {
+public:
+
+	struct Snapshot {
+		std::vector<std::shared_ptr<ODrive>> devices;		// Index is the odrive ID
+		std::unordered_map<uint64_t, int> idsBySerial;
+	};
+
+	DeviceRegistry() = default;
+
+	// Returns the ID the device was registered with, or -1 if it was rejected
+	int add(std::shared_ptr<ODrive> odrv);
+
+	std::shared_ptr<ODrive> get(int odriveID) const;
+	std::shared_ptr<ODrive> getBySerial(uint64_t serialNumber) const;
+	std::vector<std::shared_ptr<ODrive>> list() const;		// All devices, ordered by ID
+	size_t size() const;
+
+	// Keep the guard in a named variable while using it, and don't hold it for long
+	RcuCell<Snapshot>::ReadGuard snapshot() const {
+		return state.read();
+	}
+
+private:
+	RcuCell<Snapshot> state;
+};
@@ -0,0 +1,88 @@
+#pragma once
+
+#include "pch.h"
+#include "Transport.h"
+#include "json.hpp"
+
+#include <deque>
+#include <unordered_map>
+
+#define EMULATED_USB_LATENCY 0.0005				// Simulated round trip time of one request in seconds
+#define EMULATED_CALIBRATION_TIME 3.0			// Seconds a full calibration sequence takes
+#define EMULATED_SERIAL_NUMBER_BASE 0x3E8000000000ull
+#define EMULATED_REBOOT_TIME 1.0				// Seconds the device is gone from the bus after a reboot
+
+// Pretends to be an ODrive on the protocol level, for running without hardware and for benchmarks.
+// It serves a JSON definition with the most common endpoints of both axes and simulates a crude
+// motor model, so state changes, setpoints, the watchdog and the oscilloscope behave roughly like
+// on a real device.
+class EmulatedTransport : public Transport {
+public:
+
+	EmulatedTransport(uint64_t serialNumber, double latency = EMULATED_USB_LATENCY);
+
+	bool write(const uint8_t* data, size_t length) override;
+	buffer_t read(size_t maxLength) override;
+
+	// A rebooted device is gone for good and shows up again as a new one, like on USB. This returns
+	// it once when the reboot is over, with the configuration kept and the axes idle.
+	std::shared_ptr<EmulatedTransport> rebooted();
+
+private:
+	struct Property {
+		std::string type;
+		uint64_t value = 0;
+		std::function<void()> function;		// Only for functions
+	};
+
+	struct Response {
+		buffer_t data;
+		std::chrono::steady_clock::time_point ready;
+	};
+
+	struct AxisModel {
+		double calibrationEnd = 0.0;
+		double lastFeed = 0.0;
+	};
+
+	struct ScopeModel {
+		std::vector<float> buffer;
+		uint64_t cycle = 0;
+		bool capturing = false;
+	};
+
+	uint16_t addProperty(nlohmann::json& members, const std::string& path, const std::string& name, const std::string& type, bool readonly, uint64_t value = 0);
+	typedef std::vector<std::pair<std::string, std::string>> Arguments;		// Name and type
+
+	uint16_t addFunction(nlohmann::json& members, const std::string& path, const std::string& name, std::function<void()> function,
+		const Arguments& inputs = {}, const Arguments& outputs = {});
+	nlohmann::json makeAxis(int axis);
+	nlohmann::json makeOscilloscope();
+
+	float getFloat(const std::string& path);
+	void setFloat(const std::string& path, float value);
+	uint64_t getInt(const std::string& path);
+	void setInt(const std::string& path, uint64_t value);
+
+	void handleRequest(uint16_t sequence, uint16_t endpointID, uint16_t expectedSize, const uint8_t* payload, size_t payloadSize);
+	void propertyWritten(uint16_t id);
+	void simulate();
+	void writeAxisModel(const std::string& path, double pos, double vel, double torque);
+	void sampleScope();
+	static float propertyAsFloat(const Property& property);
+
+	std::string json;
+	std::vector<Property> properties;		// Index is the endpoint id
+	std::unordered_map<std::string, uint16_t> ids;
+	std::array<AxisModel, 2> axes;
+	ScopeModel scope;
+
+	std::deque<Response> responses;
+	std::mutex mutex;
+	double latency = 0.0;
+	double lastSimulation = 0.0;
+	uint64_t serialNumber = 0;
+	double rebootEnd = 0.0;
+	bool detached = false;		// Rebooted, every request fails
+	bool replaced = false;		// The device after the reboot was handed out
+};
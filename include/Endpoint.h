@@ -33,6 +33,12 @@ enum class EndpointValueType {
 	INT32
 };
 
+typedef uint32_t EndpointHandle;	// odriveID in the upper 16 bits, endpoint id in the lower 16 bits
+
+inline EndpointHandle MakeEndpointHandle(int odriveID, uint16_t id) {
+	return ((uint32_t)odriveID << 16) | id;
+}
+
 struct BasicEndpoint {
 	std::string identifier;
 	std::string name;
@@ -41,6 +47,10 @@ struct BasicEndpoint {
 	int odriveID = 0;
 	uint16_t id = 0;
 	bool readonly = false;	// Only valid for numeric types
+
+	EndpointHandle handle() const {
+		return MakeEndpointHandle(odriveID, id);
+	}
 };
 
 struct Endpoint {
@@ -185,7 +195,7 @@ public:
 		memcpy(&this->value, &value, sizeof(T));
 	}
 	
-	std::string toString() {
+	std::string toString() const {
 		std::string str;
 		std::stringstream s;
 		switch (type()) {
@@ -215,16 +225,80 @@ public:
 		return false;
 	}
 
+	double toDouble() const {
+		switch (type()) {
+		case EndpointValueType::BOOL:	return get<bool>() ? 1.0 : 0.0;
+		case EndpointValueType::FLOAT:	return get<float>();
+		case EndpointValueType::UINT8:	return get<uint8_t>();
+		case EndpointValueType::UINT16:	return get<uint16_t>();
+		case EndpointValueType::UINT32:	return get<uint32_t>();
+		case EndpointValueType::UINT64:	return (double)get<uint64_t>();
+		case EndpointValueType::INT32:	return get<int32_t>();
+		}
+		return 0.0;
+	}
+
+	// Keeps the type and converts the number into it
+	bool fromDouble(double number) {
+		value = 0;
+		switch (type()) {
+		case EndpointValueType::BOOL:	set<bool>(number != 0.0); return true;
+		case EndpointValueType::FLOAT:	set<float>((float)number); return true;
+		case EndpointValueType::UINT8:	set<uint8_t>((uint8_t)std::llround(number)); return true;
+		case EndpointValueType::UINT16:	set<uint16_t>((uint16_t)std::llround(number)); return true;
+		case EndpointValueType::UINT32:	set<uint32_t>((uint32_t)std::llround(number)); return true;
+		case EndpointValueType::UINT64:	set<uint64_t>((uint64_t)std::llround(number)); return true;
+		case EndpointValueType::INT32:	set<int32_t>((int32_t)std::llround(number)); return true;
+		}
+		return false;
+	}
+
+	// Size of the value on the wire in bytes
+	size_t size() const {
+		switch (type()) {
+		case EndpointValueType::BOOL:	return sizeof(bool);
+		case EndpointValueType::FLOAT:	return sizeof(float);
+		case EndpointValueType::UINT8:	return sizeof(uint8_t);
+		case EndpointValueType::UINT16:	return sizeof(uint16_t);
+		case EndpointValueType::UINT32:	return sizeof(uint32_t);
+		case EndpointValueType::UINT64:	return sizeof(uint64_t);
+		case EndpointValueType::INT32:	return sizeof(int32_t);
+		}
+		return 0;
+	}
+
+	// Raw little endian bytes, as the ODrive sends them
+	bool fromBytes(const uint8_t* data, size_t length) {
+		if (length != size() || length == 0)
+			return false;
+		value = 0;
+		memcpy(&value, data, length);
+		return true;
+	}
+
+	void toBytes(uint8_t* data) const {
+		memcpy(data, &value, size());
+	}
+
+	// The same number in the type of an endpoint, e.g. "float"
+	EndpointValue as(const std::string& type) const {
+		EndpointValue converted(type);
+		if (converted.type() == _type)
+			return *this;
+		converted.fromDouble(toDouble());
+		return converted;
+	}
+
 	template<typename T>
 	void operator=(T value) {
 		set<T>(value);
 	}
 
-	bool operator==(const EndpointValue& other) {
+	bool operator==(const EndpointValue& other) const {
 		return (_type == other._type) && (this->value == other.value);
 	}
 
-	bool operator!=(const EndpointValue& other) {
+	bool operator!=(const EndpointValue& other) const {
 		return !operator==(other);
 	}
 
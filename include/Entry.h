@@ -2,26 +2,30 @@
 
 #include "pch.h"
 #include "Endpoint.h"
+#include "ChangeBus.h"
 #include "config.h"
 
 class Entry {
 public:
 	Endpoint endpoint;
 	EndpointValue value;
+	SampleTime valueTime;	// When the device sampled value
 	std::map<std::string, EndpointValue> ioValues;
-	std::map<std::string, EndpointValue> oldValues;
+	std::map<std::string, SampleTime> ioTimes;	// Same for ioValues
+	std::map<std::string, std::array<char, IMGUI_BUFFER_SIZE + 1>> arguments;	// Function inputs typed by the user, by full path
 	bool toBeRemoved = false;
 	
 	size_t entryID;
-	inline static size_t entryIDCounter = 0;
+	inline static std::atomic<size_t> entryIDCounter = 0;
 	char imguiBuffer[IMGUI_BUFFER_SIZE + 1];
 	size_t selected = 0;
 
 	Entry(const Endpoint& bep);
 	Entry(const nlohmann::json& json);
 
-	void updateValue();
-	void draw();
+	void updateValue(std::vector<ValueChange>& samples);
+	void applySamples(const std::vector<ValueChange>& samples);		// Takes the values that belong to this entry
+	void draw(const std::unordered_map<EndpointHandle, double>& changeTimes);
 
 	nlohmann::json toJson();
 
@@ -33,10 +37,12 @@ public:
 	void operator=(const Entry& e) {
 		endpoint = e.endpoint;
 		value = e.value;
+		valueTime = e.valueTime;
 		ioValues = e.ioValues;
-		oldValues = e.oldValues;
+		ioTimes = e.ioTimes;
+		arguments = e.arguments;
 		toBeRemoved = e.toBeRemoved;
-		entryID = entryID;
+		entryID = e.entryID;
 		selected = 0;
 		memset(imguiBuffer, 0, sizeof(imguiBuffer));
 	}
@@ -47,6 +53,9 @@ private:
 	void drawImGuiNumberInput(Endpoint& ep, bool isfloat);
 	void drawImGuiBoolInput(Endpoint& ep);
 	void drawEndpointInput(Endpoint& ep);
+	void drawVerification(Endpoint& ep);
+	void drawArgumentInput(Endpoint& ep);
+	bool collectArguments(std::vector<EndpointValue>& inputs);
 
 	std::mutex mutex;
 };
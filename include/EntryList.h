@@ -0,0 +1,37 @@
+#pragma once
+
+#include "pch.h"
+#include "Entry.h"
+#include "Rcu.h"
+
+#include <unordered_map>
+
+// The entries of the control panel, published as copy-on-write generations. The poller and the
+// render thread iterate whatever generation was current when they started, while edits from the
+// UI produce the next generation. Entries live in shared storage and are addressed by their
+// entryID, so an entry stays valid while an older generation still uses it, and finding
+// the entry to remove is a hash lookup instead of a search by path.
+class EntryList {
+public:
+
+	struct Generation {
+		std::vector<std::shared_ptr<Entry>> entries;		// In display order
+		std::unordered_map<size_t, size_t> indices;			// entryID -> position in entries
+	};
+
+	EntryList() = default;
+
+	void add(const Entry& entry);
+	void remove(size_t entryID);
+	void replace(const std::vector<Entry>& newEntries);
+	void clear();
+
+	std::shared_ptr<Entry> get(size_t entryID) const;
+	std::vector<std::shared_ptr<Entry>> list() const;		// A stable copy of the current generation
+	size_t size() const;
+
+private:
+	static void reindex(Generation& generation, size_t first);
+
+	RcuCell<Generation> generation;
+};
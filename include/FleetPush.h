@@ -0,0 +1,63 @@
+#pragma once
+
+#include "pch.h"
+#include "DeviceRegistry.h"
+#include "Async.h"
+#include "ConfigTransaction.h"
+
+#define FLEET_RECONNECT_TIMEOUT 15.0	// Seconds a rebooting drive has to show up again
+#define FLEET_RECONNECT_POLL 0.1
+
+// Applies one parameter set to many drives at once. Every device gets its own I/O job which
+// sends the set as one ConfigTransaction, then saves and reboots it if requested. Waiting for a
+// rebooted drive to reconnect is a coroutine that sleeps in the executor, so no pool thread is
+// held while the drives restart and the whole fleet takes about as long as a single drive.
+class FleetPush {
+public:
+
+	enum class Stage {
+		QUEUED,
+		CONFIGURING,
+		SAVING,
+		REBOOTING,		// Waiting for the device to reconnect
+		DONE,
+		FAILED
+	};
+
+	struct DeviceProgress {
+		int odriveID = -1;
+		Stage stage = Stage::QUEUED;
+		ConfigTransaction::Result result;
+		std::string message;		// Why it failed
+		double duration = 0.0;
+	};
+
+	FleetPush(const DeviceRegistry& registry, AsyncExecutor& executor) : registry(registry), executor(executor) {}
+
+	// Overrides replace or extend the common parameters for single devices.
+	// Returns false if a push is still running.
+	bool start(const std::vector<int>& odriveIDs, const ConfigTransaction& parameters,
+		const std::map<int, ConfigTransaction>& overrides = {}, bool save = false, bool reboot = false);
+
+	bool running() const {
+		return active > 0;
+	}
+
+	std::vector<DeviceProgress> progress() const;
+
+	static const char* StageName(Stage stage);
+
+private:
+	void push(size_t index, ConfigTransaction transaction, bool save, bool reboot);
+	void setStage(size_t index, Stage stage, const std::string& message = "");
+	void finished();
+	Task<void> waitForReconnect(size_t index, std::shared_ptr<ODrive> previous);
+
+	const DeviceRegistry& registry;
+	AsyncExecutor& executor;
+
+	mutable std::mutex mutex;
+	std::vector<DeviceProgress> devices;
+	std::atomic<size_t> active = 0;
+	double started = 0.0;
+};
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "pch.h"
+#include "ODrive.h"
+
+#include <complex>
+
+#define BODE_DEFAULT_RATE 1000.0		// Setpoint updates and samples per second
+#define BODE_PLOT_POINTS 150			// Logarithmically spaced points of the result
+#define BODE_MULTISINE_TONES 24
+
+enum class ExcitationInput {
+	VELOCITY,		// input_vel
+	TORQUE			// input_torque
+};
+
+enum class ExcitationSignal {
+	CHIRP,			// Exponential sweep from the start to the end frequency
+	MULTISINE		// Logarithmically spaced tones with Schroeder phases, all frequencies at once
+};
+
+struct BodeSettings {
+	int axis = 0;
+	ExcitationInput input = ExcitationInput::VELOCITY;
+	ExcitationSignal signal = ExcitationSignal::CHIRP;
+	double amplitude = 0.5;			// Peak, on top of the current input value
+	double startFrequency = 1.0;	// Hz
+	double endFrequency = 100.0;
+	double duration = 10.0;			// Seconds
+	double rate = BODE_DEFAULT_RATE;
+};
+
+struct BodePoint {
+	double frequency = 0.0;		// Hz
+	double magnitude = 0.0;		// dB, vel_estimate over the input
+	double phase = 0.0;			// Degrees, unwrapped
+	double coherence = 0.0;		// 0 to 1, low means the point is mostly noise
+};
+
+struct BodeResult {
+	bool success = false;
+	std::string error;
+	std::vector<BodePoint> points;
+	size_t samples = 0;
+	size_t late = 0;			// Updates that went out more than one period late
+	size_t failed = 0;			// Updates without a response, the previous sample was held
+	double duration = 0.0;		// Seconds the excitation actually took
+};
+
+// Frequency response measurement. The excitation is written at a fixed rate, and every update
+// goes out in one batch together with the read of vel_estimate, so the response is captured in
+// the same transfer. The transfer function is the cross spectrum over the input spectrum of the
+// whole record, summed into logarithmically spaced points for the Bode plot.
+class FrequencyResponse {
+public:
+
+	// Blocks for the whole measurement. The axis must be in closed loop control.
+	static BodeResult Run(std::shared_ptr<ODrive> odrive, const BodeSettings& settings);
+
+	static double Excitation(const BodeSettings& settings, double t);
+
+	static std::vector<BodePoint> Estimate(const std::vector<double>& input, const std::vector<double>& output,
+		double rate, double minFrequency, double maxFrequency);
+
+	// In place, the size must be a power of two
+	static void FFT(std::vector<std::complex<double>>& data);
+};
@@ -4,8 +4,38 @@
 #include "Fonts.h"
 
 #include "config.h"
+#include "Backend.h"
+#include "ConfigTab.h"
+#include "SweepTab.h"
+#include "StepTab.h"
+#include "BodeTab.h"
+#include "PlayerTab.h"
+#include "SyncTab.h"
+#include "WatchdogTab.h"
+#include "ScopeTab.h"
+
+#include <set>
+#include <cfloat>
+
+#define STREAM_PLOT_HISTORY 2000		// Samples shown per channel
 
 class GraphPanel : public Battery::ImGuiPanel<> {
+
+	int calibrationAxis = 0;
+	ConfigTab configTab;
+	SweepTab sweepTab;
+	StepTab stepTab;
+	BodeTab bodeTab;
+	PlayerTab playerTab;
+	SyncTab syncTab;
+	WatchdogTab watchdogTab;
+	ScopeTab scopeTab;
+
+	std::set<std::pair<int, std::string>> streamChannels;
+	float streamRate = STREAM_DEFAULT_RATE;
+	std::vector<StreamSample> streamBatch;
+	std::map<std::pair<int, std::string>, std::vector<float>> streamHistory;
+
 public:
 
 	GraphPanel() : Battery::ImGuiPanel<>("GraphPanel", { 0, 0 }, { 400, 0 }) {
@@ -17,11 +47,224 @@ public:
 		position = { CONTROL_PANEL_WIDTH, 0 };
 	}
 
+	void drawRigTab() {
+		auto* fonts = GetFontContainer<FontContainer>();
+		ImGui::PushFont(fonts->openSans21);
+
+		ImGui::Text("Full calibration sequence");
+		ImGui::RadioButton("axis0", calibrationAxis == 0) ? calibrationAxis = 0 : 0;
+		ImGui::SameLine();
+		ImGui::RadioButton("axis1", calibrationAxis == 1) ? calibrationAxis = 1 : 0;
+		ImGui::SameLine();
+
+		if (backend->calibration.running()) {
+			ImGui::TextColored(YELLOW, "Calibrating...");
+		}
+		else if (ImGui::Button("Calibrate all drives")) {
+			std::vector<int> ids;
+			for (auto& odrive : backend->odrives.list()) {
+				if (odrive->connected) {
+					ids.push_back(odrive->odriveID);
+				}
+			}
+			backend->calibration.start(ids, calibrationAxis);
+		}
+
+		for (auto& status : backend->calibration.status()) {
+			ImGui::Text("odrv%d", status.odriveID);
+			ImGui::SameLine();
+			ImGui::SetCursorPosX(100);
+			ImVec4 color = !status.finished ? YELLOW : (status.success ? GREEN : RED);
+			ImGui::TextColored(color, "%s", status.message.c_str());
+			if (status.finished) {
+				ImGui::SameLine();
+				ImGui::SetCursorPosX(300);
+				ImGui::Text("%.1f s", status.elapsed);
+			}
+		}
+
+		ImGui::PopFont();
+	}
+
+	void startStreaming() {
+		std::vector<StreamSampler::Channel> channels;
+		for (auto& [odriveID, identifier] : streamChannels) {
+			channels.push_back({ odriveID, identifier });
+		}
+		streamHistory.clear();
+		backend->sampler.start(channels, streamRate);
+	}
+
+	void collectStreams() {
+		for (auto& stream : backend->sampler.streams()) {
+			streamBatch.clear();
+			stream->poll(streamBatch);
+			for (size_t c = 0; c < stream->identifiers.size(); c++) {
+				auto& history = streamHistory[{ stream->odriveID, stream->identifiers[c] }];
+				for (auto& sample : streamBatch) {
+					history.push_back((float)sample.values[c]);
+				}
+				if (history.size() > STREAM_PLOT_HISTORY) {
+					history.erase(history.begin(), history.end() - STREAM_PLOT_HISTORY);
+				}
+			}
+		}
+	}
+
+	void drawStreamTab() {
+		auto* fonts = GetFontContainer<FontContainer>();
+		ImGui::PushFont(fonts->openSans21);
+		bool running = backend->sampler.running();
+
+		if (running) {
+			collectStreams();
+			if (ImGui::Button("Stop streaming")) {
+				backend->sampler.stop();
+			}
+		}
+		else {
+			ImGui::Text("Channels from the control panel, up to %d per device", STREAM_MAX_CHANNELS);
+			for (auto& entry : backend->entries.list()) {
+				auto& basic = entry->endpoint.basic;
+				if (basic.type == "function")
+					continue;
+
+				std::pair<int, std::string> channel = { basic.odriveID, basic.identifier };
+				bool selected = streamChannels.count(channel) > 0;
+				if (ImGui::Checkbox(basic.fullPath.c_str(), &selected)) {
+					if (selected) streamChannels.insert(channel);
+					else streamChannels.erase(channel);
+				}
+			}
+			ImGui::InputFloat("Rate [Hz], 0 = max", &streamRate);
+			if (ImGui::Button("Start streaming")) {
+				startStreaming();
+			}
+		}
+
+		for (auto& stream : backend->sampler.streams()) {
+			StreamSampler::Stats stats = stream->stats();
+			ImGui::Text("odrv%d: %.0f Hz, jitter %.3f ms (max %.3f ms), %llu samples, %llu dropped, %llu failed",
+				stream->odriveID, stats.rate, stats.jitter * 1000.0, stats.maxJitter * 1000.0,
+				(unsigned long long)stats.samples, (unsigned long long)stats.dropped, (unsigned long long)stats.failed);
+
+			for (auto& identifier : stream->identifiers) {
+				auto& history = streamHistory[{ stream->odriveID, identifier }];
+				std::string label = "odrv" + std::to_string(stream->odriveID) + "." + identifier;
+				ImGui::PlotLines(label.c_str(), history.data(), (int)history.size(), 0, nullptr, FLT_MAX, FLT_MAX, { 0, 80 });
+			}
+		}
+
+		ImGui::PopFont();
+	}
+
+	void drawLatencyTab() {
+		auto* fonts = GetFontContainer<FontContainer>();
+		ImGui::PushFont(fonts->openSans21);
+		ImGui::Text("Time from requesting the USB link until releasing it, all devices");
+
+		auto devices = backend->odrives.list();
+		for (size_t p = 0; p < (size_t)TransferPriority::COUNT; p++) {
+			LatencyHistogram histogram;
+			for (auto& odrive : devices) {
+				histogram.merge(odrive->transferLatency((TransferPriority)p));
+			}
+
+			ImGui::Separator();
+			ImGui::Text("%s: %llu transfers, p50 < %.2f ms, p99 < %.2f ms, max %.2f ms", TransferPriorityName((TransferPriority)p),
+				(unsigned long long)histogram.count(), histogram.percentile(0.5) * 1000.0, histogram.percentile(0.99) * 1000.0, histogram.max() * 1000.0);
+
+			std::array<float, LATENCY_HISTOGRAM_BUCKETS> buckets;
+			for (size_t i = 0; i < LATENCY_HISTOGRAM_BUCKETS; i++) {
+				buckets[i] = (float)histogram.bucket(i);
+			}
+			std::string label = std::string("##latency") + std::to_string(p);
+			ImGui::PlotHistogram(label.c_str(), buckets.data(), (int)buckets.size(), 0, "1 us .. 8 s, log2 buckets", 0.f, FLT_MAX, { -1, 60 });
+		}
+
+		ImGui::Separator();
+		ImGui::Text("Read round trips, used to estimate when the device sampled each value");
+		for (auto& odrive : devices) {
+			const RoundTripEstimator& roundTrips = odrive->roundTripStats();
+			ImGui::Text("odrv%d: fastest %.3f ms, mean %.3f ms", odrive->odriveID, roundTrips.fastestRoundTrip() * 1000.0, roundTrips.meanRoundTrip() * 1000.0);
+		}
+
+		ImGui::PopFont();
+	}
+
 	void OnRender() override {
 		auto* fonts = GetFontContainer<FontContainer>();
 		ImGui::PushFont(fonts->openSans25);
 
-		ImGui::ShowDemoWindow();
+		ImGui::PushStyleColor(ImGuiCol_Button, RED);
+		if (ImGui::Button("STOP ALL DRIVES (Esc)", { -1, 40 })) {
+			backend->stopAll();
+		}
+		ImGui::PopStyleColor();
+
+		if (ImGui::BeginTabBar("GraphPanelTabs")) {
+			if (ImGui::BeginTabItem("Rig")) {
+				drawRigTab();
+				ImGui::EndTabItem();
+			}
+			if (ImGui::BeginTabItem("Stream")) {
+				drawStreamTab();
+				ImGui::EndTabItem();
+			}
+			if (ImGui::BeginTabItem("Config")) {
+				ImGui::PushFont(GetFontContainer<FontContainer>()->openSans21);
+				configTab.draw();
+				ImGui::PopFont();
+				ImGui::EndTabItem();
+			}
+			if (ImGui::BeginTabItem("Sweep")) {
+				ImGui::PushFont(GetFontContainer<FontContainer>()->openSans21);
+				sweepTab.draw();
+				ImGui::PopFont();
+				ImGui::EndTabItem();
+			}
+			if (ImGui::BeginTabItem("Step")) {
+				ImGui::PushFont(GetFontContainer<FontContainer>()->openSans21);
+				stepTab.draw();
+				ImGui::PopFont();
+				ImGui::EndTabItem();
+			}
+			if (ImGui::BeginTabItem("Bode")) {
+				ImGui::PushFont(GetFontContainer<FontContainer>()->openSans21);
+				bodeTab.draw();
+				ImGui::PopFont();
+				ImGui::EndTabItem();
+			}
+			if (ImGui::BeginTabItem("Player")) {
+				ImGui::PushFont(GetFontContainer<FontContainer>()->openSans21);
+				playerTab.draw();
+				ImGui::PopFont();
+				ImGui::EndTabItem();
+			}
+			if (ImGui::BeginTabItem("Sync")) {
+				ImGui::PushFont(GetFontContainer<FontContainer>()->openSans21);
+				syncTab.draw();
+				ImGui::PopFont();
+				ImGui::EndTabItem();
+			}
+			if (ImGui::BeginTabItem("Watchdog")) {
+				ImGui::PushFont(GetFontContainer<FontContainer>()->openSans21);
+				watchdogTab.draw();
+				ImGui::PopFont();
+				ImGui::EndTabItem();
+			}
+			if (ImGui::BeginTabItem("Scope")) {
+				ImGui::PushFont(GetFontContainer<FontContainer>()->openSans21);
+				scopeTab.draw();
+				ImGui::PopFont();
+				ImGui::EndTabItem();
+			}
+			if (ImGui::BeginTabItem("Latency")) {
+				drawLatencyTab();
+				ImGui::EndTabItem();
+			}
+			ImGui::EndTabBar();
+		}
 
 		ImGui::PopFont();
 	}
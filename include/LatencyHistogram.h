@@ -0,0 +1,68 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+
+#define LATENCY_HISTOGRAM_BUCKETS 24	// Bucket i counts latencies from 2^i to 2^(i+1) microseconds
+
+// Lock-free histogram with logarithmic buckets, any thread can record into it
+class LatencyHistogram {
+public:
+
+	void record(double seconds) {
+		double micros = seconds * 1e6;
+		size_t bucket = micros < 1.0 ? 0 : std::min((size_t)std::log2(micros), (size_t)LATENCY_HISTOGRAM_BUCKETS - 1);
+		buckets[bucket]++;
+		totalCount++;
+
+		uint64_t ns = (uint64_t)(seconds * 1e9);
+		uint64_t max = maxNanoseconds.load();
+		while (ns > max && !maxNanoseconds.compare_exchange_weak(max, ns));
+	}
+
+	uint64_t count() const {
+		return totalCount;
+	}
+
+	uint64_t bucket(size_t index) const {
+		return buckets[index];
+	}
+
+	double max() const {
+		return maxNanoseconds / 1e9;
+	}
+
+	// Upper edge of the bucket that contains the percentile in seconds, at most the maximum
+	double percentile(double p) const {
+		uint64_t total = totalCount;
+		if (total == 0)
+			return 0.0;
+
+		uint64_t target = (uint64_t)std::ceil(total * p);
+		uint64_t sum = 0;
+		for (size_t i = 0; i < LATENCY_HISTOGRAM_BUCKETS; i++) {
+			sum += buckets[i];
+			if (sum >= target) {
+				return std::min(std::exp2((double)(i + 1)) / 1e6, max());
+			}
+		}
+		return max();
+	}
+
+	void merge(const LatencyHistogram& other) {
+		for (size_t i = 0; i < LATENCY_HISTOGRAM_BUCKETS; i++) {
+			buckets[i] += other.buckets[i].load();
+		}
+		totalCount += other.totalCount.load();
+		uint64_t max = maxNanoseconds.load();
+		uint64_t otherMax = other.maxNanoseconds.load();
+		while (otherMax > max && !maxNanoseconds.compare_exchange_weak(max, otherMax));
+	}
+
+private:
+	std::array<std::atomic<uint64_t>, LATENCY_HISTOGRAM_BUCKETS> buckets = {};
+	std::atomic<uint64_t> totalCount = 0;
+	std::atomic<uint64_t> maxNanoseconds = 0;
+};
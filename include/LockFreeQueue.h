@@ -0,0 +1,58 @@
+#pragma once
+
+#include <atomic>
+#include <vector>
+
+// Bounded single-producer/single-consumer ring buffer. push() must only be called
+// from one thread at a time and pop() from one other thread, neither ever blocks.
+template<typename T>
+class SPSCQueue {
+public:
+
+	SPSCQueue(size_t capacity) {
+		size_t size = 2;
+		while (size < capacity) {	// Round up to a power of two, so the index wraps with a mask
+			size <<= 1;
+		}
+		buffer.resize(size);
+		mask = size - 1;
+	}
+
+	bool push(const T& item) {
+		size_t t = tail.load(std::memory_order_relaxed);
+		if (t - head.load(std::memory_order_acquire) >= buffer.size()) {
+			return false;	// Full
+		}
+		buffer[t & mask] = item;
+		tail.store(t + 1, std::memory_order_release);
+		return true;
+	}
+
+	bool pop(T& item) {
+		size_t h = head.load(std::memory_order_relaxed);
+		if (h == tail.load(std::memory_order_acquire)) {
+			return false;	// Empty
+		}
+		item = buffer[h & mask];
+		head.store(h + 1, std::memory_order_release);
+		return true;
+	}
+
+	size_t size() const {
+		return tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire);
+	}
+
+	size_t capacity() const {
+		return buffer.size();
+	}
+
+	bool empty() const {
+		return size() == 0;
+	}
+
+private:
+	std::vector<T> buffer;
+	size_t mask = 0;
+	alignas(64) std::atomic<size_t> head = 0;	// Only written by the consumer
+	alignas(64) std::atomic<size_t> tail = 0;	// Only written by the producer
+};
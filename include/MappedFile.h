@@ -0,0 +1,34 @@
+#pragma once
+
+#include "pch.h"
+
+// Read-only memory mapping of a whole file. Large setpoint files are parsed straight from the
+// page cache without being copied into a string first.
+class MappedFile {
+public:
+
+	MappedFile(const std::string& path);
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	bool valid() const {
+		return begin != nullptr;
+	}
+
+	const char* data() const {
+		return begin;
+	}
+
+	size_t size() const {
+		return length;
+	}
+
+private:
+	const char* begin = nullptr;
+	size_t length = 0;
+	void* fileHandle = nullptr;			// Windows only
+	void* mappingHandle = nullptr;		// Windows only
+	int descriptor = -1;				// Everywhere else
+};
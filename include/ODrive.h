@@ -3,32 +3,55 @@
 #include "libusbcpp.h"
 #include "CRC.h"
 #include "Endpoint.h"
-#include "libusbcpp.h"
+#include "Transport.h"
+#include "RequestBatch.h"
+#include "TransferArbiter.h"
+#include "SampleTime.h"
+#include "ODriveDocs.h"
 
 #include "json.hpp"
 
-#define ODRIVE_VENDOR_ID 0x1209
-#define ODRIVE_PRODUCT_ID 0x0D32
-
-#define ODRIVE_USB_INTERFACE 2
-#define ODRIVE_USB_READ_ENDPOINT (uint16_t)0x83
-#define ODRIVE_USB_WRITE_ENDPOINT (uint16_t)0x03
-
 #define ODRIVE_TIMEOUT 0.5		// Read/Write timeout in seconds
+#define ODRIVE_PIPELINE_DEPTH 16	// Max. number of requests waiting for a response at once
 
-typedef std::vector<uint8_t> buffer_t;
 using njson = nlohmann::json;
 
+// Outputs of a function call, in the order of the definition
+struct FunctionResult {
+	bool success = false;
+	std::vector<std::pair<BasicEndpoint, EndpointValue>> outputs;
+
+	EndpointValue output(const std::string& name) const {
+		for (auto& [endpoint, value] : outputs) {
+			if (endpoint.name == name)
+				return value;
+		}
+		return EndpointValue(EndpointValueType::INVALID);
+	}
+
+	template<typename T>
+	std::optional<T> get(const std::string& name) const {
+		EndpointValue value = output(name);
+		if (value.type() == EndpointValueType::INVALID)
+			return std::nullopt;
+		return (T)value.toDouble();
+	}
+};
+
 class ODrive {
 public:
 
 	bool connected = true;
 	bool loaded = false;
+	int odriveID = -1;
 	uint16_t jsonCRC = 0x00;
 	uint64_t serialNumber = 0;
 	std::string json;
 	std::vector<Endpoint> endpoints;
 	std::vector<BasicEndpoint> cachedEndpoints;
+	std::unordered_map<std::string, size_t> endpointIndex;	// identifier -> index in cachedEndpoints
+	std::unordered_map<std::string, const Endpoint*> functions;	// identifier -> function node in endpoints
+	std::vector<buffer_t> stopFrames;		// requested_state = IDLE for every axis, encoded with the endpoints
 
 	bool error = false;
 	int32_t axisError = 0x00;
@@ -36,29 +59,34 @@ public:
 	int32_t encoderError = 0x00;
 	int32_t controllerError = 0x00;
 
-	ODrive(libusbcpp::device device) : device(device) {
-		if (!device) {
-			throw std::runtime_error("ODrive device is nullptr!");
-		}
-		if (!device->claimInterface(ODRIVE_USB_INTERFACE)) {
-			throw std::runtime_error("Cannot claim USB interface");
+	ODrive(libusbcpp::device device) : ODrive(std::make_shared<UsbTransport>(device)) {
+	}
+
+	ODrive(std::shared_ptr<Transport> transport) : transport(transport) {
+		if (!transport) {
+			throw std::runtime_error("ODrive transport is nullptr!");
 		}
 		load(999);
 	}
 
+	// With a time, it receives when the request went out, when the response arrived and when the device sampled the value
 	template<typename T>
-	bool read(uint16_t endpoint, T* value_ptr) {
+	bool read(uint16_t endpoint, T* value_ptr, SampleTime* time = nullptr) {
 
 		if (!loaded || !connected)
 			return false;
 
-		std::lock_guard<std::mutex> lock(transferMutex);
+		TransferLock lock(*this);
+		double start = Battery::GetRuntime();
 		uint16_t sequence = sendReadRequest(endpoint, sizeof(T), {}, jsonCRC);
 
-		double start = Battery::GetRuntime();
 		while (Battery::GetRuntime() < start + ODRIVE_TIMEOUT) {
-			auto& response = getResponse(sizeof(T));
+			auto response = getResponse(sizeof(T));
 			if ((response.first & 0b0111111111111111) == sequence && response.second.size() == sizeof(T)) {
+				SampleTime sampleTime = roundTrips.stamp(start, Battery::GetRuntime());
+				if (time) {
+					*time = sampleTime;
+				}
 				memcpy(value_ptr, &response.second[0], sizeof(T));
 				return true;
 			}
@@ -85,7 +113,7 @@ public:
 		std::vector<uint8_t> payload(sizeof(T), 0);
 		memcpy(&payload[0], &value, sizeof(T));
 
-		std::lock_guard<std::mutex> lock(transferMutex);
+		TransferLock lock(*this);
 		sendWriteRequest(endpoint, sizeof(T), payload, jsonCRC);
 
 		return true;
@@ -100,12 +128,233 @@ public:
 		return false;
 	}
 
-	void executeFunction(const std::string& identifier) {
-		auto endpoint = findEndpoint(identifier);
-		if (endpoint) {
-			std::lock_guard<std::mutex> lock(transferMutex);
-			sendWriteRequest(endpoint->id, 1, { 0 }, jsonCRC);
+	// Reads any numeric endpoint with the type from the JSON definition
+	EndpointValue readValue(const BasicEndpoint& ep, SampleTime* time = nullptr) {
+		auto endpoint = findEndpoint(ep.identifier);
+		if (!endpoint)
+			return EndpointValue(EndpointValueType::INVALID);
+
+		EndpointValue value(endpoint->type);
+		switch (value.type()) {
+		case EndpointValueType::BOOL:	{ bool v = 0;		if (read(endpoint->id, &v, time)) return EndpointValue(v); break; }
+		case EndpointValueType::FLOAT:	{ float v = 0;		if (read(endpoint->id, &v, time)) return EndpointValue(v); break; }
+		case EndpointValueType::UINT8:	{ uint8_t v = 0;	if (read(endpoint->id, &v, time)) return EndpointValue(v); break; }
+		case EndpointValueType::UINT16:	{ uint16_t v = 0;	if (read(endpoint->id, &v, time)) return EndpointValue(v); break; }
+		case EndpointValueType::UINT32:	{ uint32_t v = 0;	if (read(endpoint->id, &v, time)) return EndpointValue(v); break; }
+		case EndpointValueType::UINT64:	{ uint64_t v = 0;	if (read(endpoint->id, &v, time)) return EndpointValue(v); break; }
+		case EndpointValueType::INT32:	{ int32_t v = 0;	if (read(endpoint->id, &v, time)) return EndpointValue(v); break; }
+		}
+		return EndpointValue(EndpointValueType::INVALID);
+	}
+
+	bool writeValue(const BasicEndpoint& ep, const EndpointValue& value) {
+		auto endpoint = findEndpoint(ep.identifier);
+		if (!endpoint)
+			return false;
+
+		switch (value.type()) {
+		case EndpointValueType::BOOL:	return write(endpoint->id, value.get<bool>());
+		case EndpointValueType::FLOAT:	return write(endpoint->id, value.get<float>());
+		case EndpointValueType::UINT8:	return write(endpoint->id, value.get<uint8_t>());
+		case EndpointValueType::UINT16:	return write(endpoint->id, value.get<uint16_t>());
+		case EndpointValueType::UINT32:	return write(endpoint->id, value.get<uint32_t>());
+		case EndpointValueType::UINT64:	return write(endpoint->id, value.get<uint64_t>());
+		case EndpointValueType::INT32:	return write(endpoint->id, value.get<int32_t>());
+		}
+		return false;
+	}
+
+	// Sends all requests of the batch and collects the responses into batch.results. Up to
+	// ODRIVE_PIPELINE_DEPTH requests are in flight at once, so a batch of n reads takes about
+	// n / ODRIVE_PIPELINE_DEPTH round trips instead of n. Returns false if a response is missing.
+	bool transact(RequestBatch& batch) {
+
+		batch.results.assign(batch.requests.size(), EndpointValue());
+		batch.times.assign(batch.requests.size(), SampleTime());
+		batch.sent = batch.received = 0.0;
+		if (!loaded || !connected)
+			return false;
+
+		TransferLock lock(*this);
+		size_t next = 0;
+		size_t inFlight = 0;
+		size_t missing = 0;
+		double lastProgress = Battery::GetRuntime();
+
+		while (next < batch.requests.size() || inFlight > 0) {
+
+			// Between requests, with the pipeline empty, more important transfers may go first
+			if (inFlight == 0 && next > 0) {
+				lock.yield();
+			}
+
+			// Fill the pipeline, but stop early if something more important is waiting
+			while (next < batch.requests.size() && inFlight < ODRIVE_PIPELINE_DEPTH) {
+				if (inFlight > 0 && arbiter.higherWaiting(TransferPriorityScope::get()))
+					break;
+
+				const RequestBatch::Request& request = batch.requests[next];
+				sequenceNumber = (sequenceNumber + 1) % 4096;
+				batch.times[next].sent = Battery::GetRuntime();
+				if (next == 0) {
+					batch.sent = batch.times[next].sent;
+				}
+				write(batch.patch(next, sequenceNumber, jsonCRC), request.length);
+				if (request.expectsResponse) {
+					pendingRequests[sequenceNumber] = (int32_t)next;
+					inFlight++;
+				}
+				next++;
+			}
+
+			if (!connected)
+				break;
+
+			if (inFlight == 0)
+				continue;
+
+			// A failed read yields sequence 0, which may belong to a real request after a wrap.
+			// Every request expecting a response has a payload, so an empty one is never an answer.
+			auto response = getResponse(batch.maxResponseSize);
+			uint16_t sequence = response.first & 0b0111111111111111;
+			int32_t index = response.second.empty() ? -1 : pendingRequests[sequence];
+			if (index >= 0) {
+				pendingRequests[sequence] = -1;
+				batch.times[index] = roundTrips.stamp(batch.times[index].sent, Battery::GetRuntime());
+				batch.results[index] = EndpointValue(batch.requests[index].type);
+				if (!batch.results[index].fromBytes(response.second.data(), response.second.size())) {
+					batch.results[index] = EndpointValue();
+					missing++;
+				}
+				inFlight--;
+				lastProgress = Battery::GetRuntime();
+			}
+			else if (Battery::GetRuntime() > lastProgress + ODRIVE_TIMEOUT || !connected) {
+				break;
+			}
+		}
+
+		batch.received = Battery::GetRuntime();
+		if (inFlight > 0) {
+			LOG_WARN("Timeout: {} of {} batched requests got no response", inFlight, batch.requests.size());
+			pendingRequests.fill(-1);
+		}
+		return inFlight == 0 && missing == 0;
+	}
+
+	// Latest value wins: if the endpoint still has an unsent write pending, its value is replaced
+	// instead of queueing another write. Pending writes go out before the next transfer, or right
+	// away if the device is idle. Meant for setpoints that change faster than they can be sent.
+	bool postValue(const BasicEndpoint& ep, const EndpointValue& value) {
+		auto endpoint = findEndpoint(ep.identifier);
+		if (!endpoint || value.type() == EndpointValueType::INVALID)
+			return false;
+
+		{
+			std::lock_guard<std::mutex> lock(writeSlotMutex);
+			auto it = writeSlotIndex.find(endpoint->id);
+			if (it != writeSlotIndex.end()) {
+				writeSlots[it->second].second = value;
+				coalescedWrites++;
+			}
+			else {
+				writeSlotIndex.emplace(endpoint->id, writeSlots.size());
+				writeSlots.emplace_back(endpoint->id, value);
+			}
+			postedWrites++;
+		}
+
+		drainWrites();
+		return true;
+	}
+
+	// Idles every axis right away. The frames are sent directly on the transport without waiting
+	// for the link: they don't ask for a response, so they can't confuse a transfer in progress.
+	// Pending posted writes are dropped, so no queued setpoint or state change follows the stop.
+	bool stop() {
+		{
+			std::lock_guard<std::mutex> lock(writeSlotMutex);
+			writeSlots.clear();
+			writeSlotIndex.clear();
+		}
+
+		bool success = !stopFrames.empty();
+		for (auto& frame : stopFrames) {
+			success &= transport->write(frame.data(), frame.size());
+		}
+		return success;
+	}
+
+	struct WriteStats {
+		uint64_t posted = 0;
+		uint64_t coalesced = 0;		// Superseded by a newer value before they were sent
+	};
+
+	WriteStats writeStats() const {
+		return { postedWrites.load(), coalescedWrites.load() };
+	}
+
+	const LatencyHistogram& transferLatency(TransferPriority priority) const {
+		return arbiter.latency(priority);
+	}
+
+	// Round trips of the reads so far, they place the sample time of every read value
+	const RoundTripEstimator& roundTripStats() const {
+		return roundTrips;
+	}
+
+	// Writes all inputs, triggers the function and reads all outputs in one pipelined batch.
+	// The inputs are converted to the types of the function arguments.
+	FunctionResult call(const std::string& identifier, const std::vector<EndpointValue>& inputs = {}) {
+		FunctionResult result;
+
+		auto it = functions.find(identifier);
+		if (!loaded || it == functions.end()) {
+			LOG_ERROR("Function '{}' was not found", identifier);
+			return result;
+		}
+
+		const Endpoint& function = *it->second;
+		if (inputs.size() != function.inputs.size()) {
+			LOG_ERROR("Function '{}' takes {} arguments, {} were given", identifier, function.inputs.size(), inputs.size());
+			return result;
+		}
+
+		RequestBatch batch;
+		for (size_t i = 0; i < inputs.size(); i++) {
+			batch.addWrite(function.inputs[i].basic, inputs[i].as(function.inputs[i].basic.type));
 		}
+		batch.addCall(function.basic);
+		size_t firstOutput = batch.size();
+		for (auto& output : function.outputs) {
+			batch.addRead(output.basic);
+		}
+
+		result.success = transact(batch);
+		for (size_t i = 0; i < function.outputs.size(); i++) {
+			result.outputs.emplace_back(function.outputs[i].basic, batch.results[firstOutput + i]);
+		}
+		return result;
+	}
+
+	// Firmware with an output reports through it whether the configuration was written, it refuses
+	// while an axis is armed. Without an output the save is unconfirmed, sending it counts.
+	bool saveConfiguration() {
+		FunctionResult result = call("save_configuration");
+		if (!result.success)
+			return false;
+		return result.outputs.empty() || result.outputs[0].second.toDouble() != 0.0;
+	}
+
+	bool executeFunction(const std::string& identifier) {
+		return call(identifier).success;
+	}
+
+	// False as well if the state can't be read
+	bool inClosedLoopControl(int axis) {
+		uint8_t state = 0;
+		return read<uint8_t>("axis" + std::to_string(axis) + ".current_state", &state) &&
+			state == (uint8_t)AxisRequestedState::AXIS_STATE_CLOSED_LOOP_CONTROL;
 	}
 
 	void updateErrors() {
@@ -124,7 +373,7 @@ public:
 
 	void load(int odriveID) {
 
-		std::lock_guard<std::mutex> lock(transferMutex);
+		TransferLock lock(*this);
 		connected = true;
 		json = getJSON();
 		jsonCRC = CRC16_JSON((uint8_t*)&json[0], json.length());
@@ -139,14 +388,98 @@ public:
 
 	void setODriveID(int odriveID) {
 		// Reload the cache
+		this->odriveID = odriveID;
 		generateEndpoints(odriveID);
 	}
 
 	operator bool() {
-		return (bool)(connected && device && loaded);
+		return (bool)(connected && transport && loaded);
+	}
+
+	BasicEndpoint* findEndpoint(const std::string& identifier) {
+
+		if (!loaded)
+			return nullptr;
+
+		auto it = endpointIndex.find(identifier);
+		if (it != endpointIndex.end()) {
+			return &cachedEndpoints[it->second];
+		}
+
+		LOG_ERROR("Endpoint '{}' was not found in the cache", identifier);
+		return nullptr;
 	}
 
 private:
+	// Holds the link with the priority of the calling thread and sends posted writes before
+	// the transfer and before releasing it
+	class TransferLock {
+	public:
+		TransferLock(ODrive& odrive) : odrive(odrive), priority(TransferPriorityScope::get()), start(Battery::GetRuntime()) {
+			odrive.arbiter.acquire(priority);
+			odrive.sendPendingWrites();
+		}
+
+		~TransferLock() {
+			odrive.sendPendingWrites();
+			odrive.arbiter.release();
+			odrive.arbiter.recordLatency(priority, Battery::GetRuntime() - start);
+			odrive.drainWrites();		// Writes posted while we were releasing
+		}
+
+		// Lets more important transfers go first, only call it between requests
+		void yield() {
+			if (odrive.arbiter.higherWaiting(priority)) {
+				odrive.sendPendingWrites();
+				odrive.arbiter.release();
+				odrive.arbiter.acquire(priority);
+			}
+		}
+
+	private:
+		ODrive& odrive;
+		TransferPriority priority;
+		double start;
+	};
+
+	// Whoever gets the link sends the pending writes. If it is taken, the holder sends them
+	// when it releases the link, so no write waits for the next unrelated transfer.
+	void drainWrites() {
+		while (true) {
+			{
+				std::lock_guard<std::mutex> lock(writeSlotMutex);
+				if (writeSlots.empty())
+					return;
+			}
+
+			if (!arbiter.tryAcquire(TransferPriorityScope::get()))
+				return;
+
+			sendPendingWrites();
+			arbiter.release();
+		}
+	}
+
+	// Must be called while holding the link
+	void sendPendingWrites() {
+		{
+			std::lock_guard<std::mutex> lock(writeSlotMutex);
+			if (writeSlots.empty())
+				return;
+			std::swap(writeSlots, writesInFlight);
+			writeSlotIndex.clear();
+		}
+
+		if (loaded && connected) {
+			for (auto& [endpointID, value] : writesInFlight) {
+				buffer_t payload(value.size(), 0);
+				value.toBytes(&payload[0]);
+				sendWriteRequest(endpointID, (uint16_t)value.size(), payload, jsonCRC);
+			}
+		}
+		writesInFlight.clear();
+	}
+
 	void disconnect() {
 		connected = false;
 	}
@@ -155,6 +488,8 @@ private:
 
 		endpoints.clear();
 		cachedEndpoints.clear();
+		endpointIndex.clear();
+		functions.clear();
 
 		try {
 
@@ -166,12 +501,48 @@ private:
 
 				endpoints.push_back(makeNode(subnode, "", odriveID));
 			}
+
+			for (size_t i = 0; i < cachedEndpoints.size(); i++) {
+				endpointIndex.emplace(cachedEndpoints[i].identifier, i);
+			}
+			for (auto& endpoint : endpoints) {
+				indexFunctions(endpoint);
+			}
+			generateStopFrames();
 		}
 		catch (...) {
 			LOG_ERROR("Error while parsing json definition!");
 			disconnect();
 			endpoints.clear();
 			cachedEndpoints.clear();
+			endpointIndex.clear();
+			functions.clear();
+			stopFrames.clear();
+		}
+	}
+
+	void indexFunctions(const Endpoint& node) {
+		if (node.basic.type == "function") {
+			functions.emplace(node.basic.identifier, &node);
+		}
+		for (auto& child : node.children) {
+			indexFunctions(child);
+		}
+	}
+
+	void generateStopFrames() {
+		stopFrames.clear();
+		for (int axis = 0; ; axis++) {
+			auto it = endpointIndex.find("axis" + std::to_string(axis) + ".requested_state");
+			if (it == endpointIndex.end())
+				break;
+
+			RequestBatch frame;
+			EndpointValue idle(cachedEndpoints[it->second].type);
+			idle.fromDouble(AxisRequestedState::AXIS_STATE_IDLE);
+			frame.addWrite(cachedEndpoints[it->second], idle);
+			frame.patch(0, 0, jsonCRC);		// Nothing is matched against the sequence number of a write
+			stopFrames.push_back(frame.frames);
 		}
 	}
 
@@ -209,21 +580,6 @@ private:
 		return ep;
 	}
 
-	BasicEndpoint* findEndpoint(const std::string& identifier) {
-
-		if (!loaded)
-			return nullptr;
-
-		for (auto& ep : cachedEndpoints) {
-			if (ep.identifier == identifier) {
-				return &ep;
-			}
-		}
-
-		LOG_ERROR("Endpoint '{}' was not found in the cache", identifier);
-		return nullptr;
-	}
-
 	uint16_t sendReadRequest(uint16_t endpointID, uint16_t expectedResponseSize, const buffer_t& payload, uint16_t jsonCRC) {
 		return sendRequest((1 << 15) | endpointID, expectedResponseSize, payload, jsonCRC);
 	}
@@ -263,7 +619,7 @@ private:
 
 	void write(uint8_t* data, size_t length) {
 		for (int i = 0; i < 5; i++) {
-			if (device->bulkWrite(data, length, ODRIVE_USB_WRITE_ENDPOINT) != -1) {
+			if (transport->write(data, length)) {
 				return;
 			}
 		}
@@ -271,7 +627,7 @@ private:
 	}
 
 	std::vector<uint8_t> read(size_t expectedLength) {
-		auto data = device->bulkRead(expectedLength + 2, ODRIVE_USB_READ_ENDPOINT);
+		auto data = transport->read(expectedLength + 2);
 		if (data.size() == 0) {
 			disconnect();
 		}
@@ -294,6 +650,12 @@ private:
 		return std::make_pair(sequence, buffer);
 	}
 
+	static std::array<int32_t, 4096> MakePendingRequests() {
+		std::array<int32_t, 4096> requests;
+		requests.fill(-1);
+		return requests;
+	}
+
 	std::string getJSON() {
 		std::string json;
 
@@ -316,7 +678,16 @@ private:
 		return json;
 	}
 
-	libusbcpp::device device;
-	inline static uint16_t sequenceNumber = 0;
-	std::mutex transferMutex;
+	std::shared_ptr<Transport> transport;
+	uint16_t sequenceNumber = 0;		// Per device, only changed while holding the link
+	std::array<int32_t, 4096> pendingRequests = MakePendingRequests();	// Sequence number -> request index in the current batch
+	TransferArbiter arbiter;
+	RoundTripEstimator roundTrips;
+
+	std::vector<std::pair<uint16_t, EndpointValue>> writeSlots;		// In the order they were first posted
+	std::vector<std::pair<uint16_t, EndpointValue>> writesInFlight;
+	std::unordered_map<uint16_t, size_t> writeSlotIndex;			// Endpoint id -> index in writeSlots
+	std::mutex writeSlotMutex;
+	std::atomic<uint64_t> postedWrites = 0;
+	std::atomic<uint64_t> coalescedWrites = 0;
 };
@@ -0,0 +1,81 @@
+#pragma once
+
+#include "pch.h"
+#include "config.h"
+#include "Backend.h"
+
+// Graph panel tab for playing setpoint files through the TrajectoryPlayer
+class PlayerTab {
+
+	std::array<char, IMGUI_BUFFER_SIZE + 1> path = {};
+	std::shared_ptr<const Trajectory> trajectory;
+	std::string loadError;
+	std::string playError;
+	bool realtime = false;
+	bool pin = false;
+	int cpu = 1;
+
+public:
+
+	void draw() {
+		ImGui::PushItemWidth(400);
+		ImGui::InputText("CSV file", path.data(), IMGUI_BUFFER_SIZE);
+		ImGui::PopItemWidth();
+		ImGui::SameLine();
+		if (ImGui::Button("Load") && !backend->player.running()) {
+			auto loaded = Trajectory::Load(path.data(), loadError);
+			trajectory = loaded ? std::make_shared<const Trajectory>(std::move(*loaded)) : nullptr;
+		}
+
+		if (!loadError.empty()) {
+			ImGui::TextColored(RED, "%s", loadError.c_str());
+		}
+		if (!trajectory)
+			return;
+
+		ImGui::Text("%zu setpoints over %.3f s", trajectory->times.size(), trajectory->duration());
+		for (auto& target : trajectory->targets) {
+			ImGui::BulletText("odrv%d.%s", target.odriveID, target.identifier.c_str());
+		}
+
+		ImGui::Checkbox("Real-time priority", &realtime);
+		ImGui::SameLine();
+		ImGui::Checkbox("Pin to CPU", &pin);
+		if (pin) {
+			ImGui::SameLine();
+			ImGui::PushItemWidth(100);
+			ImGui::InputInt("##cpu", &cpu);
+			ImGui::PopItemWidth();
+		}
+
+		if (backend->player.running()) {
+			if (ImGui::Button("Stop")) {
+				backend->player.stop();
+			}
+		}
+		else if (ImGui::Button("Play")) {
+			TrajectoryPlayer::Options options;
+			options.realtime = realtime;
+			options.cpu = pin ? cpu : -1;
+			playError.clear();
+			backend->player.start(trajectory, options, playError);
+		}
+		if (!playError.empty()) {
+			ImGui::TextColored(RED, "%s", playError.c_str());
+		}
+
+		TrajectoryPlayer::Stats stats = backend->player.stats();
+		if (stats.total == 0)
+			return;
+
+		ImGui::ProgressBar((float)stats.sent / stats.total);
+		ImGui::Text("Sent %zu of %zu, %zu late writes (> %.1f ms), %zu failed", stats.sent, stats.total, stats.late, PLAYER_LATE_THRESHOLD * 1000.0, stats.failed);
+		const LatencyHistogram& jitter = backend->player.jitter();
+		ImGui::Text("Send jitter: mean %.3f ms, p50 %.3f ms, p99 %.3f ms, max %.3f ms", stats.meanJitter * 1000.0,
+			jitter.percentile(0.5) * 1000.0, jitter.percentile(0.99) * 1000.0, stats.maxJitter * 1000.0);
+		for (auto& device : stats.devices) {
+			ImGui::Text("odrv%d: %zu late, %zu failed, jitter mean %.3f ms, max %.3f ms", device.odriveID, device.late, device.failed,
+				device.meanJitter * 1000.0, device.maxJitter * 1000.0);
+		}
+	}
+};
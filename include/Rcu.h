@@ -0,0 +1,121 @@
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+// Read-copy-update cell. Readers get the current immutable version with two atomic increments
+// and two atomic loads, they never lock and never wait. Writers copy the current version, modify
+// the copy and publish it.
+//
+// Readers are counted in one of two epochs. A replaced version is kept with the epoch that was
+// current when it was replaced, and the epoch moves on once the other one has no readers left.
+// The versions of an epoch are deleted when it is left behind and its last reader is gone, either
+// by the next writer or by that reader itself, which only tries the writer lock and never waits.
+// So under constant reading, reclamation never waits for a moment without any reader at all,
+// only for the readers that started before the version was replaced.
+template<typename T>
+class RcuCell {
+public:
+
+	class ReadGuard {
+	public:
+		ReadGuard(const ReadGuard&) = delete;
+		ReadGuard& operator=(const ReadGuard&) = delete;
+
+		ReadGuard(ReadGuard&& other) noexcept : cell(other.cell), data(other.data), epoch(other.epoch) {
+			other.cell = nullptr;
+		}
+
+		~ReadGuard() {
+			if (cell && cell->readers[epoch].fetch_sub(1) == 1 && cell->reclaimPending) {
+				cell->tryReclaim();
+			}
+		}
+
+		const T* operator->() const {
+			return data;
+		}
+
+		const T& operator*() const {
+			return *data;
+		}
+
+	private:
+		friend class RcuCell;
+		ReadGuard(const RcuCell* cell, const T* data, unsigned epoch) : cell(cell), data(data), epoch(epoch) {}
+
+		const RcuCell* cell;
+		const T* data;
+		unsigned epoch;
+	};
+
+	RcuCell() : current(new T()) {}
+
+	~RcuCell() {
+		delete current.load();
+		for (auto& versions : retired) {
+			for (T* version : versions) {
+				delete version;
+			}
+		}
+	}
+
+	RcuCell(const RcuCell&) = delete;
+	RcuCell& operator=(const RcuCell&) = delete;
+
+	ReadGuard read() const {
+		unsigned e = epoch.load();
+		readers[e].fetch_add(1);						// Must be visible before the pointer is loaded,
+		return ReadGuard(this, current.load(), e);		// all of them are sequentially consistent
+	}
+
+	// Writers are serialized. The function receives a copy of the current version to modify.
+	template<typename F>
+	void update(F&& modify) {
+		std::lock_guard<std::mutex> lock(writerMutex);
+		T* next = new T(*current.load());
+		modify(*next);
+		retired[epoch.load()].push_back(current.exchange(next));
+		reclaimPending = true;
+		reclaim();
+	}
+
+private:
+	// Called with the writer lock held
+	void reclaim() const {
+		// A reader counted in the idle epoch either started before the epoch moved on, or it
+		// loaded the pointer after its increment and so got a version that was never retired
+		// there. Once its count is zero, nobody holds the versions retired in it. Leaving the
+		// active epoch lets it drain the same way, at most two steps free everything.
+		for (int step = 0; step < 2; step++) {
+			unsigned active = epoch.load();
+			unsigned idle = active ^ 1;
+			if (readers[idle].load() != 0)
+				break;
+
+			for (T* version : retired[idle]) {
+				delete version;
+			}
+			retired[idle].clear();
+			if (retired[active].empty())
+				break;
+			epoch.store(idle);
+		}
+		reclaimPending = !retired[0].empty() || !retired[1].empty();
+	}
+
+	void tryReclaim() const {
+		std::unique_lock<std::mutex> lock(writerMutex, std::try_to_lock);
+		if (lock.owns_lock()) {
+			reclaim();
+		}
+	}
+
+	std::atomic<T*> current;
+	mutable std::atomic<unsigned> epoch = 0;
+	mutable std::atomic<size_t> readers[2] = {};
+	mutable std::atomic<bool> reclaimPending = false;	// There are retired versions
+	mutable std::mutex writerMutex;
+	mutable std::vector<T*> retired[2];					// Per epoch they were replaced in
+};
@@ -0,0 +1,124 @@
+#pragma once
+
+#include "pch.h"
+#include "Endpoint.h"
+#include "Transport.h"
+#include "SampleTime.h"
+
+// A list of requests that is encoded once and can then be sent any number of times. ODrive::transact
+// sends them back to back without waiting for each response in between and only patches the
+// sequence numbers and the JSON CRC into the prepared frames, so repeating a batch costs no encoding.
+class RequestBatch {
+public:
+
+	struct Request {
+		uint16_t endpointID = 0;		// Without the ack bit
+		bool expectsResponse = false;
+		EndpointValueType type = EndpointValueType::INVALID;
+		size_t offset = 0;				// Where the frame starts in frames
+		size_t length = 0;
+	};
+
+	std::vector<Request> requests;
+	buffer_t frames;
+	std::vector<EndpointValue> results;		// One per request after a transaction, INVALID if there was no response
+	size_t maxResponseSize = 0;
+	std::vector<SampleTime> times;			// One per request after a transaction, only sent is set without a response
+	double sent = 0.0;						// Runtime when the first frame of the last transaction went out
+	double received = 0.0;					// Runtime when its last response arrived, or when it ended without one
+
+	// All add functions return the index of the request and its result
+	size_t addRead(const BasicEndpoint& endpoint) {
+		EndpointValue value(endpoint.type);
+		return addRequest(endpoint.id, (uint16_t)value.size(), nullptr, 0, value.type(), true);
+	}
+
+	// With ack the device answers with the value after the write, which makes it a write and read-back in one
+	size_t addWrite(const BasicEndpoint& endpoint, const EndpointValue& value, bool ack = false) {
+		uint8_t payload[sizeof(uint64_t)];
+		value.toBytes(payload);
+		return addRequest(endpoint.id, (uint16_t)value.size(), payload, value.size(), value.type(), ack);
+	}
+
+	size_t addCall(const BasicEndpoint& endpoint) {
+		uint8_t payload = 0;
+		return addRequest(endpoint.id, 1, &payload, 1, EndpointValueType::INVALID, false);
+	}
+
+	size_t size() const {
+		return requests.size();
+	}
+
+	bool empty() const {
+		return requests.empty();
+	}
+
+	void clear() {
+		requests.clear();
+		frames.clear();
+		results.clear();
+		times.clear();
+		maxResponseSize = 0;
+	}
+
+	// When the whole batch was sampled: from the first send to the last response, with the
+	// estimated sample times of all reads averaged
+	SampleTime sampleTime() const {
+		double sum = 0.0;
+		size_t count = 0;
+		for (size_t i = 0; i < times.size(); i++) {
+			if (requests[i].expectsResponse && times[i].received > 0.0) {
+				sum += times[i].sampled;
+				count++;
+			}
+		}
+		return { sent, received, count > 0 ? sum / count : (sent + received) / 2.0 };
+	}
+
+	// Replaces the value of a write in place, so a batch can carry a changing setpoint without re-encoding.
+	// The value must have the same type as the one the write was added with.
+	void setValue(size_t index, const EndpointValue& value) {
+		value.toBytes(&frames[requests[index].offset + 6]);
+	}
+
+	// Called by the ODrive right before the frame is sent
+	uint8_t* patch(size_t index, uint16_t sequence, uint16_t jsonCRC) {
+		uint8_t* frame = &frames[requests[index].offset];
+		frame[0] = (uint8_t)(sequence);
+		frame[1] = (uint8_t)(sequence >> 8);
+		frame[requests[index].length - 2] = (uint8_t)(jsonCRC);
+		frame[requests[index].length - 1] = (uint8_t)(jsonCRC >> 8);
+		return frame;
+	}
+
+private:
+	size_t addRequest(uint16_t endpointID, uint16_t responseSize, const uint8_t* payload, size_t payloadSize, EndpointValueType type, bool expectsResponse) {
+
+		Request request;
+		request.endpointID = endpointID;
+		request.expectsResponse = expectsResponse;
+		request.type = type;
+		request.offset = frames.size();
+		request.length = payloadSize + 8;
+
+		uint16_t id = expectsResponse ? ((1 << 15) | endpointID) : endpointID;
+		frames.push_back(0);		// Sequence number, patched later
+		frames.push_back(0);
+		frames.push_back((uint8_t)(id));
+		frames.push_back((uint8_t)(id >> 8));
+		frames.push_back((uint8_t)(responseSize));
+		frames.push_back((uint8_t)(responseSize >> 8));
+		for (size_t i = 0; i < payloadSize; i++) {
+			frames.push_back(payload[i]);
+		}
+		frames.push_back(0);		// JSON CRC, patched later
+		frames.push_back(0);
+
+		if (expectsResponse) {
+			maxResponseSize = std::max(maxResponseSize, (size_t)responseSize);
+		}
+
+		requests.push_back(request);
+		return requests.size() - 1;
+	}
+};
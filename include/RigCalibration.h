@@ -0,0 +1,44 @@
+#pragma once
+
+#include "pch.h"
+#include "Async.h"
+#include "DeviceRegistry.h"
+
+#define CALIBRATION_TIMEOUT 60.0		// Seconds a full calibration sequence may take
+
+// Runs AXIS_STATE_FULL_CALIBRATION_SEQUENCE on many drives at once: the requests are written to
+// all drives in parallel and then a single poll loop waits until every axis is back to idle
+class RigCalibration {
+public:
+
+	struct DeviceStatus {
+		int odriveID = 0;
+		bool finished = false;
+		bool success = false;
+		std::string message;
+		double elapsed = 0.0;
+	};
+
+	RigCalibration(AsyncExecutor& executor, const DeviceRegistry& registry) : executor(executor), registry(registry) {}
+
+	void start(const std::vector<int>& odriveIDs, int axis);
+
+	bool running() const {
+		return isRunning;
+	}
+
+	std::vector<DeviceStatus> status() const {
+		std::lock_guard<std::mutex> lock(mutex);
+		return devices;
+	}
+
+private:
+	Task<void> run(std::vector<int> odriveIDs, int axis);
+
+	AsyncExecutor& executor;
+	const DeviceRegistry& registry;
+	std::atomic<bool> isRunning = false;
+
+	mutable std::mutex mutex;
+	std::vector<DeviceStatus> devices;
+};
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "pch.h"
+
+#define ROUNDTRIP_FLOOR_DECAY 0.002		// How quickly the fastest round trip forgets an old minimum, per response
+#define ROUNDTRIP_MEAN_WEIGHT 0.01		// Weight of a new round trip in the moving average
+
+// When a value was read, all in runtime seconds on the host's monotonic clock
+struct SampleTime {
+	double sent = 0.0;			// The request went out
+	double received = 0.0;		// The response arrived
+	double sampled = 0.0;		// Estimate of when the device took the value, see RoundTripEstimator
+
+	double roundTrip() const {
+		return received - sent;
+	}
+
+	// For values that were not read by a request of their own, like function outputs
+	static SampleTime At(double runtime) {
+		return { runtime, runtime, runtime };
+	}
+};
+
+// Round trip statistics of one device, used to place the moment a value was sampled between the
+// send and receive time. The fastest recent round trip is a request that went straight through:
+// the device answered at once and both directions took about half of it. Anything slower spent
+// the extra time queued, mostly behind earlier requests in the pipeline, so the device sampled
+// about half the fastest round trip before the response arrived. Without queueing this is the
+// plain midpoint of the round trip.
+class RoundTripEstimator {
+public:
+
+	// Updates the statistics with one response and returns its sample time
+	SampleTime stamp(double sent, double received) {
+		double roundTrip = received - sent;
+		double floor = fastest.load();
+		floor = (floor <= 0.0 || roundTrip < floor) ? roundTrip : floor + (roundTrip - floor) * ROUNDTRIP_FLOOR_DECAY;
+		fastest = floor;
+		double average = mean.load();
+		mean = average <= 0.0 ? roundTrip : average + (roundTrip - average) * ROUNDTRIP_MEAN_WEIGHT;
+		return { sent, received, std::max(sent, received - floor / 2.0) };
+	}
+
+	double fastestRoundTrip() const {
+		return fastest;
+	}
+
+	double meanRoundTrip() const {
+		return mean;
+	}
+
+private:
+	std::atomic<double> fastest = 0.0;
+	std::atomic<double> mean = 0.0;
+};
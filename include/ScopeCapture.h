@@ -0,0 +1,52 @@
+#pragma once
+
+#include "pch.h"
+#include "ODrive.h"
+#include "ChannelCapture.h"
+
+#define SCOPE_MAX_CHANNELS 4
+#define SCOPE_DEFAULT_SAMPLE_RATE 8000.0	// Control loop rate of the firmware, for devices that don't report it
+#define SCOPE_DOWNLOAD_CHUNK 256			// get_val calls per batch, of which ODRIVE_PIPELINE_DEPTH are in flight at a time
+#define SCOPE_CAPTURE_TIMEOUT 10.0			// Seconds to wait for the buffer to fill
+#define SCOPE_POLL_INTERVAL 0.005			// Seconds between checks of the fill level
+
+struct ScopeSettings {
+	std::vector<std::string> sources;		// Identifiers to record, empty keeps what the device records
+	uint32_t decimation = 1;				// Record every n-th control loop cycle
+	bool trigger = true;					// Start a new capture, otherwise download what the buffer holds
+};
+
+struct ScopeResult {
+	bool success = false;
+	std::string error;
+	std::vector<std::string> channels;		// One label per column
+	CaptureColumns columns;					// Only timestamps and values, the samples were not read one by one
+	double sampleRate = 0.0;				// Per channel
+	size_t values = 0;						// Downloaded from the buffer, all channels together
+	double captureTime = 0.0;				// Seconds from the trigger until the buffer was full
+	double downloadTime = 0.0;
+};
+
+// Captures signals with the oscilloscope in the firmware, which records at the control loop rate
+// into a buffer on the device, far faster than the host could poll. The buffer is read back with
+// get_val(index) calls, each one a write of the index, the call and a read of the value. They are
+// pre-encoded into batches of SCOPE_DOWNLOAD_CHUNK calls and only the indices are patched per
+// batch. The transfer pipelines them with up to ODRIVE_PIPELINE_DEPTH value reads waiting for
+// their responses at a time, so the download is not one round trip per value. The channels are
+// interleaved in the buffer and are split into columns, timestamped from the moment the device
+// handled the trigger.
+class ScopeCapture {
+public:
+
+	// The device has a scope buffer that can be downloaded
+	static bool Supported(ODrive& odrive);
+
+	// The recorded sources and the decimation can be chosen
+	static bool Configurable(ODrive& odrive);
+
+	// Blocks until the capture is downloaded
+	static ScopeResult Run(std::shared_ptr<ODrive> odrive, const ScopeSettings& settings, const std::atomic<bool>* abort = nullptr);
+
+	// Reads the values [0, count) of the buffer
+	static bool Download(ODrive& odrive, size_t count, std::vector<float>& values, const std::atomic<bool>* abort = nullptr);
+};
@@ -0,0 +1,116 @@
+#pragma once
+
+#include "pch.h"
+#include "config.h"
+#include "Backend.h"
+#include "ScopeCapture.h"
+#include "SweepTab.h"
+
+#include <cfloat>
+#include <future>
+
+#define SCOPE_PLOT_HEIGHT 120
+
+// Graph panel tab for the firmware oscilloscope: configure, trigger, download and plot a capture
+class ScopeTab {
+
+	int odriveSelected = 0;
+	std::array<char, IMGUI_BUFFER_SIZE + 1> sourceList = { "axis0.encoder.pos_estimate, axis0.encoder.vel_estimate, axis0.motor.current_control.Iq_measured" };
+	int decimation = 1;
+	bool trigger = true;
+
+	std::future<ScopeResult> pending;
+	ScopeResult lastResult;
+	std::vector<std::vector<float>> plotValues;		// The columns as floats for ImGui
+
+public:
+
+	void draw() {
+		drawSettings();
+		ImGui::Separator();
+		drawResult();
+	}
+
+private:
+	void drawSettings() {
+		ImGui::PushItemWidth(150);
+		if (ImGui::BeginCombo("Device##scope", ("odrv" + std::to_string(odriveSelected)).c_str())) {
+			for (auto& odrive : backend->odrives.list()) {
+				if (ImGui::Selectable(("odrv" + std::to_string(odrive->odriveID)).c_str(), odrive->odriveID == odriveSelected)) {
+					odriveSelected = odrive->odriveID;
+				}
+			}
+			ImGui::EndCombo();
+		}
+		ImGui::PopItemWidth();
+
+		auto odrive = backend->odrives.get(odriveSelected);
+		if (!odrive)
+			return;
+		if (!ScopeCapture::Supported(*odrive)) {
+			ImGui::TextDisabled("The firmware of odrv%d has no oscilloscope", odriveSelected);
+			return;
+		}
+
+		if (ScopeCapture::Configurable(*odrive)) {
+			ImGui::PushItemWidth(500);
+			ImGui::InputText("Sources, comma separated##scope", sourceList.data(), IMGUI_BUFFER_SIZE);
+			ImGui::PopItemWidth();
+			ImGui::PushItemWidth(150);
+			ImGui::InputInt("Decimation##scope", &decimation);
+			ImGui::PopItemWidth();
+			decimation = std::max(decimation, 1);
+		}
+		else {
+			ImGui::TextDisabled("The sources are fixed in this firmware");
+		}
+		ImGui::Checkbox("Trigger a new capture", &trigger);
+
+		if (pending.valid()) {
+			if (pending.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+				lastResult = pending.get();
+				plotValues.clear();
+				for (auto& column : lastResult.columns.values) {
+					plotValues.emplace_back(column.begin(), column.end());
+				}
+			}
+			else {
+				ImGui::TextColored(YELLOW, "Capturing...");
+				return;
+			}
+		}
+
+		if (ImGui::Button("Capture")) {
+			ScopeSettings settings;
+			if (ScopeCapture::Configurable(*odrive)) {
+				settings.sources = SweepTab::splitChannels(sourceList.data());
+				settings.decimation = (uint32_t)decimation;
+			}
+			settings.trigger = trigger;
+			pending = backend->ioPool.async([odrive, settings] {
+				return ScopeCapture::Run(odrive, settings);
+			});
+		}
+	}
+
+	void drawResult() {
+		const ScopeResult& result = lastResult;
+		if (!result.error.empty()) {
+			ImGui::TextColored(RED, "%s", result.error.c_str());
+			return;
+		}
+		if (!result.success)
+			return;
+
+		const CaptureColumns& columns = result.columns;
+		double span = columns.size() > 1 ? columns.timestamps.back() - columns.timestamps.front() : 0.0;
+		ImGui::Text("%zu samples per channel at %.0f Hz over %.3f s", columns.size(), result.sampleRate, span);
+		if (result.downloadTime > 0.0) {
+			ImGui::Text("Downloaded %zu values in %.3f s (%.0f values/s)", result.values, result.downloadTime, result.values / result.downloadTime);
+		}
+
+		for (size_t c = 0; c < plotValues.size() && c < result.channels.size(); c++) {
+			ImGui::PlotLines(result.channels[c].c_str(), plotValues[c].data(), (int)plotValues[c].size(), 0, nullptr, FLT_MAX, FLT_MAX, { 0, SCOPE_PLOT_HEIGHT });
+		}
+	}
+};
@@ -15,6 +15,7 @@
 class StatusBar : public Battery::ImGuiPanel<> {
 
 	int odriveSelected = 0;
+	float popupPosX = 0.f;
 	bool openODriveInfo = false;
 	bool openEndpointSelector = false;
 
@@ -25,7 +26,7 @@ public:
 	FontContainer* fonts = nullptr;
 
 	StatusBar() : Battery::ImGuiPanel<>("StatusBar", { 0, 0 }, { 400, 0 }, 
-		DEFAULT_IMGUI_PANEL_FLAGS | ImGuiWindowFlags_NoScrollWithMouse | ImGuiWindowFlags_NoScrollbar | ImGuiWindowFlags_HorizontalScrollbar)
+		DEFAULT_IMGUI_PANEL_FLAGS | ImGuiWindowFlags_NoScrollWithMouse | ImGuiWindowFlags_NoScrollbar)
 	{
 	}
 
@@ -39,39 +40,82 @@ public:
 
 	void makeODriveClickableFields() {
 
-		ImGui::Columns(4);
+		// One fixed-width field per device as long as they fit, the last slot then becomes a
+		// selector for all the devices that don't get a field of their own
+		auto odrives = backend->odrives.list();
+		size_t slots = std::max<size_t>((size_t)(windowWidth / STATUS_BAR_ELEMENTS_WIDTH), 1);
+		size_t fields = odrives.size() <= slots ? odrives.size() : slots - 1;
+		for (size_t i = 0; i < fields; i++) {
+			auto& odrive = odrives[i];
+			float x = (float)STATUS_BAR_ELEMENTS_WIDTH * i;
+			ImGui::SetCursorPosX(x);
+			ImGui::SetCursorPosY(0);
+
+			float screenX = ImGui::GetCursorScreenPos().x;
+			if (ImGui::Selectable(("##Selectable" + std::to_string(i)).c_str(), false, 0, ImVec2(STATUS_BAR_ELEMENTS_WIDTH - 15, 45))) {
+				openODriveInfo = true;
+				odriveSelected = (int)i;
+				popupPosX = std::clamp(screenX, 0.f, std::max(windowWidth - STATUS_BAR_ELEMENTS_WIDTH, 0.f));
+			}
 
-		for (int i = 0; i < MAX_NUMBER_OF_ODRIVES; i++) {
-			ImGui::SetColumnWidth(i, STATUS_BAR_ELEMENTS_WIDTH);
-			auto& odrive = backend->odrives[i];
-			if (odrive) {
+			ImGui::SetCursorPosX(x + 50);
+			ImGui::SetCursorPosY(8.5);
 
-				ImGui::SetCursorPosY(0);
-				openODriveInfo = ImGui::Selectable(("##Selectable" + std::to_string(i)).c_str(), false, 0, ImVec2(size.x / 4.f - 15, 45));
-				if (openODriveInfo) {
-					odriveSelected = i;
-				}
+			if (odrive->error) {
+				ImGui::TextColored(RED, "odrv%d", (int)i);
+			}
+			else {
+				ImGui::Text("odrv%d", (int)i);
+			}
+			ImGui::SameLine();
+			if (odrive->connected) {
+				ImGui::TextColored(GREEN, "[Connected]");
+			}
+			else {
+				ImGui::TextColored(RED, "[Disconnected]");
+			}
+			ImGui::SameLine();
+		}
 
-				ImGui::SetCursorPosX(ImGui::GetCursorPosX() + 50);
-				ImGui::SetCursorPosY(8.5);
+		if (fields < odrives.size()) {
+			makeODriveSelector(odrives, fields);
+		}
+		ImGui::Dummy({ 0, 0 });
+	}
 
-				if (backend->odrives[i]->error) {
-					ImGui::TextColored(RED, "odrv%d", i);
-				}
-				else {
-					ImGui::Text("odrv%d", i);
-				}
-				ImGui::SameLine();
-				if (backend->odrives[i]->connected) {
-					ImGui::TextColored(GREEN, "[Connected]");
-				}
-				else {
-					ImGui::TextColored(RED, "[Disconnected]");
+	void makeODriveSelector(const std::vector<std::shared_ptr<ODrive>>& odrives, size_t first) {
+
+		bool anyError = false;
+		for (size_t i = first; i < odrives.size(); i++) {
+			anyError |= odrives[i]->error || !odrives[i]->connected;
+		}
+
+		float x = (float)STATUS_BAR_ELEMENTS_WIDTH * first;
+		ImGui::SetCursorPosX(x + 10);
+		ImGui::SetCursorPosY(4);
+		ImGui::PushItemWidth(STATUS_BAR_ELEMENTS_WIDTH - 35);
+		if (anyError) {
+			ImGui::PushStyleColor(ImGuiCol_Text, RED);
+		}
+		std::string preview = "+" + std::to_string(odrives.size() - first) + " more";
+		bool open = ImGui::BeginCombo("##MoreODrives", preview.c_str());
+		if (anyError) {
+			ImGui::PopStyleColor();
+		}
+
+		if (open) {
+			for (size_t i = first; i < odrives.size(); i++) {
+				auto& odrive = odrives[i];
+				std::string label = "odrv" + std::to_string(i) + (odrive->connected ? "  [Connected]" : "  [Disconnected]") + (odrive->error ? "  [Error]" : "");
+				if (ImGui::Selectable(label.c_str(), false)) {
+					openODriveInfo = true;
+					odriveSelected = (int)i;
+					popupPosX = std::clamp(x, 0.f, std::max(windowWidth - STATUS_BAR_ELEMENTS_WIDTH, 0.f));
 				}
 			}
-
-			ImGui::NextColumn();
+			ImGui::EndCombo();
 		}
+		ImGui::PopItemWidth();
 	}
 
 	template<typename T>
@@ -107,11 +151,16 @@ public:
 		}
 		
 		// Handle the odrive info popup
-		ImGui::SetNextWindowPos({ (float)STATUS_BAR_ELEMENTS_WIDTH * odriveSelected, windowHeight - STATUS_BAR_HEIGHT - ODRIVE_POPUP_HEIGHT });
+		ImGui::SetNextWindowPos({ popupPosX, windowHeight - STATUS_BAR_HEIGHT - ODRIVE_POPUP_HEIGHT });
 		ImGui::SetNextWindowSize({ STATUS_BAR_ELEMENTS_WIDTH, ODRIVE_POPUP_HEIGHT });
 		ImGui::PushStyleVar(ImGuiStyleVar_WindowPadding, { 12, 12 });
 		if (ImGui::BeginPopupContextWindow("ODriveInfo")) {
-			auto odrive = backend->odrives[std::clamp(odriveSelected, 0, 3)];
+			auto odrive = backend->odrives.get(odriveSelected);
+			if (!odrive) {
+				ImGui::EndPopup();
+				ImGui::PopStyleVar();
+				return;
+			}
 
 			static float vbus_voltage = 0.f;
 
@@ -133,6 +182,9 @@ public:
 			ImGui::TextColored(LIGHT_BLUE, "0x%02X", odrive->jsonCRC);
 			ImGui::PopStyleVar();
 
+			ODrive::WriteStats writes = odrive->writeStats();
+			ImGui::Text("Writes: %llu, coalesced: %llu", (unsigned long long)writes.posted, (unsigned long long)writes.coalesced);
+
 			if (odrive->connected) {
 				openEndpointSelector = ImGui::Button("Show endpoints", { -1, 40 });
 
@@ -180,7 +232,7 @@ public:
 
 
 				if (ImGui::Button("Clear errors", { -1, 40 })) {
-					odrive->executeFunction("axis0.clear_errors");
+					backend->clearErrors(odriveSelected);
 				}
 
 				ImGui::PopStyleVar();
@@ -308,10 +360,11 @@ public:
 
 	void drawEndpointList() {
 
-		if (!backend->odrives[odriveSelected])
+		auto odrive = backend->odrives.get(odriveSelected);
+		if (!odrive)
 			return;
 
-		for (Endpoint& ep : backend->odrives[odriveSelected]->endpoints) {
+		for (Endpoint& ep : odrive->endpoints) {
 			drawEndpoint(ep, ImGui::GetCursorPosX());
 		}
 	}
@@ -328,8 +381,6 @@ public:
 		ImGui::SetNextWindowPos({ 0, 0 });
 		ImGui::SetNextWindowSizeConstraints({ ENDPOINT_SELECTOR_WIDTH, -1 }, { windowWidth, -1 });
 		if (ImGui::BeginPopupContextWindow("EndpointSelector")) {
-			auto odrive = backend->odrives[std::clamp(odriveSelected, 0, 3)];
-
 			ImGui::PushStyleVar(ImGuiStyleVar_ItemSpacing, { 0, 15 });
 			ImGui::Text("Endpoints of odrv%d:", odriveSelected);
 			ImGui::Separator();
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "pch.h"
+#include "ODrive.h"
+#include "ChannelCapture.h"
+
+#define STEP_BASELINE_TIME 0.05			// Seconds captured before the step
+#define STEP_RESAMPLE_PERIOD 0.0005		// Runs are interpolated onto a common grid with this period
+#define STEP_SETTLING_BAND 0.02			// Settled when the response stays within 2% of the final value
+#define STEP_MAX_REPEATS 20
+#define STEP_REST_RATE 100.0			// Samples per second while the axis returns between runs
+#define STEP_METRIC_LANES 4				// Independent accumulators of the analysis, they map onto SIMD registers
+
+enum class StepKind {
+	POSITION,		// Steps input_pos, the response is pos_estimate
+	VELOCITY		// Steps input_vel, the response is vel_estimate
+};
+
+struct StepSettings {
+	int axis = 0;
+	StepKind kind = StepKind::POSITION;
+	double amplitude = 1.0;		// Turns or turns per second
+	double duration = 0.5;		// Seconds captured after the step
+	double rest = 0.5;			// Seconds between stepping back and the next run
+	int repeats = 1;			// Runs that are averaged
+};
+
+struct StepMetrics {
+	double riseTime = NAN;			// 10% to 90% of the final value
+	double overshoot = 0.0;			// Percent of the final value
+	double settlingTime = NAN;		// Since the step
+	double steadyStateError = 0.0;	// Amplitude minus the final value
+};
+
+struct StepResult {
+	bool success = false;
+	std::string error;
+	double rate = 0.0;					// Achieved samples per second
+
+	// All relative to the value before the step, on a grid starting STEP_BASELINE_TIME before it
+	std::vector<double> time;
+	std::vector<std::vector<double>> runs;		// The response channel of every run
+	std::vector<double> response;				// Average of all runs
+	std::vector<double> velocity;				// Averaged vel_estimate
+	std::vector<double> current;				// Averaged Iq_measured, not relative
+	StepMetrics metrics;
+};
+
+// Step test for tuning the control loops. Every run captures the baseline, writes the step and
+// captures pos_estimate, vel_estimate and Iq_measured as fast as possible, then steps back and
+// rests. The runs are put onto a common time grid and averaged to reduce noise.
+class StepResponse {
+public:
+
+	// Blocks for the whole test. The axis must be in closed loop control.
+	static StepResult Run(std::shared_ptr<ODrive> odrive, const StepSettings& settings);
+
+	static StepMetrics Analyze(const std::vector<double>& time, const std::vector<double>& response, double amplitude);
+
+	// Linear interpolation of samples with increasing timestamps onto the grid
+	static void Resample(const std::vector<double>& timestamps, const std::vector<double>& values,
+		const std::vector<double>& grid, std::vector<double>& resampled);
+};
@@ -0,0 +1,158 @@
+#pragma once
+
+#include "pch.h"
+#include "config.h"
+#include "Backend.h"
+#include "StepResponse.h"
+
+#include <future>
+#include <cfloat>
+
+#define STEP_PLOT_HEIGHT 250
+
+// Graph panel tab for step tests: settings, metrics and all runs overlaid with their average
+class StepTab {
+
+	int odriveSelected = 0;
+	int axis = 0;
+	int kind = 0;		// 0 position, 1 velocity
+	float amplitude = 1.0f;
+	float duration = 0.5f;
+	float rest = 0.5f;
+	int repeats = 3;
+
+	std::future<StepResult> pending;
+	StepResult lastResult;
+	StepSettings lastSettings;
+
+public:
+
+	void draw() {
+		drawSettings();
+		ImGui::Separator();
+		drawResult();
+	}
+
+private:
+	void drawSettings() {
+		ImGui::PushItemWidth(150);
+		if (ImGui::BeginCombo("Device##step", ("odrv" + std::to_string(odriveSelected)).c_str())) {
+			for (auto& odrive : backend->odrives.list()) {
+				if (ImGui::Selectable(("odrv" + std::to_string(odrive->odriveID)).c_str(), odrive->odriveID == odriveSelected)) {
+					odriveSelected = odrive->odriveID;
+				}
+			}
+			ImGui::EndCombo();
+		}
+		ImGui::SameLine();
+		ImGui::RadioButton("axis0##step", axis == 0) ? axis = 0 : 0;
+		ImGui::SameLine();
+		ImGui::RadioButton("axis1##step", axis == 1) ? axis = 1 : 0;
+		ImGui::RadioButton("Position step", kind == 0) ? kind = 0 : 0;
+		ImGui::SameLine();
+		ImGui::RadioButton("Velocity step", kind == 1) ? kind = 1 : 0;
+		ImGui::InputFloat("Amplitude", &amplitude);
+		ImGui::InputFloat("Capture time [s]##step", &duration);
+		ImGui::InputFloat("Rest between runs [s]", &rest);
+		ImGui::InputInt("Runs", &repeats);
+		ImGui::PopItemWidth();
+
+		if (pending.valid()) {
+			if (pending.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+				lastResult = pending.get();
+			}
+			else {
+				ImGui::TextColored(YELLOW, "Running...");
+				return;
+			}
+		}
+
+		auto odrive = backend->odrives.get(odriveSelected);
+		if (ImGui::Button("Run step test") && odrive) {
+			StepSettings settings;
+			settings.axis = axis;
+			settings.kind = kind == 0 ? StepKind::POSITION : StepKind::VELOCITY;
+			settings.amplitude = amplitude;
+			settings.duration = duration;
+			settings.rest = rest;
+			settings.repeats = repeats;
+			lastSettings = settings;
+			pending = backend->ioPool.async([odrive, settings] {
+				return StepResponse::Run(odrive, settings);
+			});
+		}
+	}
+
+	void drawResult() {
+		if (!lastResult.error.empty()) {
+			ImGui::TextColored(RED, "%s", lastResult.error.c_str());
+		}
+		if (!lastResult.success)
+			return;
+
+		const StepMetrics& m = lastResult.metrics;
+		ImGui::Text("Rise time %.1f ms, overshoot %.1f%%, settling time %.1f ms, steady-state error %.4g",
+			m.riseTime * 1000.0, m.overshoot, m.settlingTime * 1000.0, m.steadyStateError);
+		ImGui::Text("%zu runs at %.0f Hz", lastResult.runs.size(), lastResult.rate);
+
+		drawOverlay();
+
+		std::vector<float> velocity(lastResult.velocity.begin(), lastResult.velocity.end());
+		std::vector<float> current(lastResult.current.begin(), lastResult.current.end());
+		ImGui::PlotLines("vel_estimate", velocity.data(), (int)velocity.size(), 0, nullptr, FLT_MAX, FLT_MAX, { 0, 80 });
+		ImGui::PlotLines("Iq_measured", current.data(), (int)current.size(), 0, nullptr, FLT_MAX, FLT_MAX, { 0, 80 });
+	}
+
+	// Every run in grey, the average on top, the target dashed and the settling time as a marker
+	void drawOverlay() {
+		auto& time = lastResult.time;
+		if (time.size() < 2)
+			return;
+
+		double low = 0.0;
+		double high = lastSettings.amplitude;
+		for (auto& run : lastResult.runs) {
+			for (double value : run) {
+				low = std::min(low, value);
+				high = std::max(high, value);
+			}
+		}
+		if (high <= low)
+			return;
+
+		ImVec2 origin = ImGui::GetCursorScreenPos();
+		float width = ImGui::GetContentRegionAvail().x;
+		float height = STEP_PLOT_HEIGHT;
+		auto point = [&](double t, double value) {
+			return ImVec2(origin.x + (float)((t - time.front()) / (time.back() - time.front())) * width,
+				origin.y + height - (float)((value - low) / (high - low)) * height);
+		};
+
+		ImDrawList* drawList = ImGui::GetWindowDrawList();
+		std::vector<ImVec2> points(time.size());
+		auto drawCurve = [&](const std::vector<double>& values, ImU32 color, float thickness) {
+			for (size_t k = 0; k < time.size(); k++) {
+				points[k] = point(time[k], values[k]);
+			}
+			drawList->AddPolyline(points.data(), (int)points.size(), color, 0, thickness);
+		};
+
+		drawList->AddRect(origin, { origin.x + width, origin.y + height }, ImGui::ColorConvertFloat4ToU32({ 0.5f, 0.5f, 0.5f, 1.f }));
+		for (auto& run : lastResult.runs) {
+			drawCurve(run, ImGui::ColorConvertFloat4ToU32({ 0.6f, 0.6f, 0.6f, 0.5f }), 1.f);
+		}
+		drawCurve(lastResult.response, ImGui::ColorConvertFloat4ToU32(GREEN), 2.f);
+
+		ImU32 marker = ImGui::ColorConvertFloat4ToU32(YELLOW);
+		for (double t = time.front(); t < time.back(); t += (time.back() - time.front()) / 50) {		// Dashed target
+			drawList->AddLine(point(t, lastSettings.amplitude), point(t + (time.back() - time.front()) / 100, lastSettings.amplitude), marker);
+		}
+		drawList->AddLine(point(0.0, low), point(0.0, high), marker);
+		if (!std::isnan(lastResult.metrics.settlingTime)) {
+			double t = lastResult.metrics.settlingTime;
+			drawList->AddLine(point(t, low), point(t, high), ImGui::ColorConvertFloat4ToU32(RED));
+		}
+
+		ImGui::Dummy({ width, height });
+	}
+};
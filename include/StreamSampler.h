@@ -0,0 +1,87 @@
+#pragma once
+
+#include "pch.h"
+#include "DeviceRegistry.h"
+#include "LockFreeQueue.h"
+#include "RequestBatch.h"
+
+#define STREAM_MAX_CHANNELS 8			// Per device
+#define STREAM_BUFFER_SIZE 65536		// Samples buffered per device until the consumer picks them up
+#define STREAM_DEFAULT_RATE 1000.0		// Samples per second, 0 means as fast as possible
+#define STREAM_STATS_INTERVAL 1.0		// Seconds over which rate and jitter are measured
+
+// One batch read of all channels of a device
+struct StreamSample {
+	SampleTime time;		// time.sampled is the best timestamp for analysis
+	std::array<double, STREAM_MAX_CHANNELS> values = {};
+};
+
+// Samples a fixed set of channels per device as fast as the USB allows. Every device gets its own
+// thread which repeatedly sends one pre-encoded batch read for all of its channels and pushes the
+// timestamped result into a lock-free ring buffer, which the consumer drains whenever it wants.
+class StreamSampler {
+public:
+
+	struct Channel {
+		int odriveID = 0;
+		std::string identifier;
+	};
+
+	struct Stats {
+		double rate = 0.0;			// Achieved samples per second
+		double jitter = 0.0;		// Standard deviation of the sample interval in seconds
+		double maxJitter = 0.0;		// Largest deviation of an interval from the target period
+		uint64_t samples = 0;
+		uint64_t dropped = 0;		// Ring buffer was full, the consumer is too slow
+		uint64_t failed = 0;		// Batch reads without a complete response
+	};
+
+	class Stream {
+	public:
+		Stream(int odriveID) : odriveID(odriveID), buffer(STREAM_BUFFER_SIZE) {}
+
+		// Moves all new samples into the vector, only ever call this from one thread
+		size_t poll(std::vector<StreamSample>& samples);
+
+		Stats stats() const {
+			std::lock_guard<std::mutex> lock(statsMutex);
+			return currentStats;
+		}
+
+		const int odriveID;
+		std::vector<std::string> identifiers;
+
+	private:
+		friend class StreamSampler;
+
+		RequestBatch batch;
+		SPSCQueue<StreamSample> buffer;
+		std::thread thread;
+
+		mutable std::mutex statsMutex;
+		Stats currentStats;
+	};
+
+	StreamSampler(const DeviceRegistry& registry) : registry(registry) {}
+	~StreamSampler();
+
+	// Channels beyond STREAM_MAX_CHANNELS per device are ignored
+	bool start(const std::vector<Channel>& channels, double rate = STREAM_DEFAULT_RATE);
+	void stop();
+
+	bool running() const {
+		return isRunning;
+	}
+
+	// Only valid while no one calls start() or stop()
+	const std::vector<std::unique_ptr<Stream>>& streams() const {
+		return activeStreams;
+	}
+
+private:
+	void sampleLoop(Stream& stream, std::shared_ptr<ODrive> odrive, double rate);
+
+	const DeviceRegistry& registry;
+	std::vector<std::unique_ptr<Stream>> activeStreams;
+	std::atomic<bool> isRunning = false;
+};
@@ -0,0 +1,92 @@
+#pragma once
+
+#include "pch.h"
+#include "DeviceRegistry.h"
+#include "ChannelCapture.h"
+
+#define SWEEP_MAX_STEPS 100				// Per parameter
+
+// One parameter stepped linearly from one value to another
+struct SweepParameter {
+	std::string identifier;
+	double from = 0.0;
+	double to = 0.0;
+	int steps = 1;
+
+	double value(int step) const {
+		return steps > 1 ? from + (to - from) * step / (steps - 1) : from;
+	}
+};
+
+struct SweepSettings {
+	std::vector<int> odriveIDs;
+	SweepParameter first;
+	std::optional<SweepParameter> second;	// Makes it a grid
+	std::vector<std::string> channels;		// Captured at every point
+	double settleTime = 0.5;				// Seconds between applying the values and capturing
+	double captureTime = 1.0;
+	double rate = 0.0;						// Samples per second, 0 means as fast as possible
+};
+
+#define METRIC_LANES 4		// Independent accumulators of the metric kernels, one SIMD register of doubles or two
+
+struct ChannelMetrics {
+	double mean = 0.0;
+	double deviation = 0.0;			// Standard deviation
+	double peakToPeak = 0.0;
+
+	static ChannelMetrics Compute(const std::vector<double>& samples);
+};
+
+struct SweepPoint {
+	int firstStep = 0;
+	int secondStep = 0;
+	bool success = false;
+	double rate = 0.0;				// Achieved samples per second
+	std::vector<ChannelMetrics> metrics;	// One per channel
+};
+
+// Runs a parameter sweep on several drives at once, each on its own thread. At every point the
+// values are applied as one verified ConfigTransaction, then the runner waits for the settle time
+// and captures the channels. When the sweep ends or is stopped, the original values are restored.
+class SweepRunner {
+public:
+
+	struct DeviceSweep {
+		int odriveID = -1;
+		std::vector<SweepPoint> points;		// In the order they were measured
+		std::string error;
+	};
+
+	SweepRunner(const DeviceRegistry& registry) : registry(registry) {}
+	~SweepRunner();
+
+	bool start(const SweepSettings& settings);
+	void stop();		// Aborts and waits until the original values are restored
+
+	bool running() const {
+		return active > 0;
+	}
+
+	size_t totalPoints() const;
+
+	// Only valid while no one calls start()
+	const SweepSettings& settings() const {
+		return currentSettings;
+	}
+
+	std::vector<DeviceSweep> results() const;
+
+private:
+	void sweep(size_t index);
+	void fail(size_t index, const std::string& error);
+
+	const DeviceRegistry& registry;
+	SweepSettings currentSettings;
+	std::vector<std::thread> threads;
+	std::atomic<size_t> active = 0;
+	std::atomic<bool> abort = false;
+
+	mutable std::mutex mutex;
+	std::vector<DeviceSweep> devices;
+};
@@ -0,0 +1,205 @@
+#pragma once
+
+#include "pch.h"
+#include "config.h"
+#include "Backend.h"
+
+#include <set>
+
+#define SWEEP_HEATMAP_CELL 24		// Pixels per grid point
+
+// Graph panel tab for parameter sweeps: settings, progress and the results as a table or heatmap
+class SweepTab {
+
+	std::array<char, IMGUI_BUFFER_SIZE + 1> firstIdentifier = { "axis0.controller.config.vel_gain" };
+	std::array<char, IMGUI_BUFFER_SIZE + 1> secondIdentifier = { "axis0.controller.config.vel_integrator_gain" };
+	std::array<char, IMGUI_BUFFER_SIZE + 1> channelList = { "axis0.encoder.vel_estimate, axis0.motor.current_control.Iq_measured" };
+	float firstRange[2] = { 0.05f, 0.3f };
+	float secondRange[2] = { 0.1f, 0.5f };
+	int firstSteps = 6;
+	int secondSteps = 5;
+	bool twoParameters = false;
+	float settleTime = 0.5f;
+	float captureTime = 1.0f;
+	float rate = 0.0f;
+	std::set<int> devicesSelected;
+
+	int metricChannel = 0;
+	int metric = 0;		// 0 mean, 1 deviation, 2 peak to peak
+
+public:
+
+	void draw() {
+		if (backend->sweeps.running()) {
+			if (ImGui::Button("Abort sweep")) {
+				backend->sweeps.stop();
+			}
+		}
+		else {
+			drawSettings();
+		}
+
+		ImGui::Separator();
+		drawResults();
+	}
+
+	static std::vector<std::string> splitChannels(const std::string& list) {
+		std::vector<std::string> channels;
+		std::stringstream stream(list);
+		std::string channel;
+		while (std::getline(stream, channel, ',')) {
+			channel.erase(0, channel.find_first_not_of(" \t"));
+			channel.erase(channel.find_last_not_of(" \t") + 1);
+			if (!channel.empty()) {
+				channels.push_back(channel);
+			}
+		}
+		return channels;
+	}
+
+private:
+	void drawSettings() {
+		ImGui::PushItemWidth(350);
+		ImGui::InputText("Parameter", firstIdentifier.data(), IMGUI_BUFFER_SIZE);
+		ImGui::PopItemWidth();
+		ImGui::PushItemWidth(200);
+		ImGui::InputFloat2("From, to##first", firstRange);
+		ImGui::SameLine();
+		ImGui::InputInt("Steps##first", &firstSteps);
+
+		ImGui::Checkbox("Second parameter", &twoParameters);
+		if (twoParameters) {
+			ImGui::PushItemWidth(350);
+			ImGui::InputText("Parameter##second", secondIdentifier.data(), IMGUI_BUFFER_SIZE);
+			ImGui::PopItemWidth();
+			ImGui::InputFloat2("From, to##second", secondRange);
+			ImGui::SameLine();
+			ImGui::InputInt("Steps##second", &secondSteps);
+		}
+
+		ImGui::InputText("Channels, comma separated", channelList.data(), IMGUI_BUFFER_SIZE);
+		ImGui::InputFloat("Settle time [s]", &settleTime);
+		ImGui::InputFloat("Capture time [s]", &captureTime);
+		ImGui::InputFloat("Rate [Hz], 0 = max##sweep", &rate);
+		ImGui::PopItemWidth();
+
+		for (auto& odrive : backend->odrives.list()) {
+			bool selected = devicesSelected.count(odrive->odriveID) > 0;
+			if (ImGui::Checkbox(("odrv" + std::to_string(odrive->odriveID) + "##sweep").c_str(), &selected)) {
+				selected ? (void)devicesSelected.insert(odrive->odriveID) : (void)devicesSelected.erase(odrive->odriveID);
+			}
+			ImGui::SameLine();
+		}
+		ImGui::NewLine();
+
+		if (ImGui::Button("Start sweep")) {
+			SweepSettings settings;
+			settings.odriveIDs.assign(devicesSelected.begin(), devicesSelected.end());
+			settings.first = { firstIdentifier.data(), firstRange[0], firstRange[1], firstSteps };
+			if (twoParameters) {
+				settings.second = SweepParameter{ secondIdentifier.data(), secondRange[0], secondRange[1], secondSteps };
+			}
+			settings.channels = splitChannels(channelList.data());
+			settings.settleTime = settleTime;
+			settings.captureTime = captureTime;
+			settings.rate = rate;
+			backend->sweeps.start(settings);
+			metricChannel = 0;
+		}
+	}
+
+	double metricValue(const SweepPoint& point) const {
+		if (!point.success || metricChannel >= (int)point.metrics.size())
+			return NAN;
+		const ChannelMetrics& m = point.metrics[metricChannel];
+		return metric == 0 ? m.mean : (metric == 1 ? m.deviation : m.peakToPeak);
+	}
+
+	void drawResults() {
+		const SweepSettings& settings = backend->sweeps.settings();
+		auto results = backend->sweeps.results();
+		if (results.empty())
+			return;
+
+		for (size_t i = 0; i < settings.channels.size(); i++) {
+			ImGui::RadioButton((settings.channels[i] + "##metric").c_str(), metricChannel == (int)i) ? metricChannel = (int)i : 0;
+			ImGui::SameLine();
+		}
+		ImGui::NewLine();
+		ImGui::RadioButton("Mean", metric == 0) ? metric = 0 : 0;
+		ImGui::SameLine();
+		ImGui::RadioButton("Std. deviation", metric == 1) ? metric = 1 : 0;
+		ImGui::SameLine();
+		ImGui::RadioButton("Peak to peak", metric == 2) ? metric = 2 : 0;
+
+		for (auto& device : results) {
+			ImGui::Text("odrv%d: %zu of %zu points", device.odriveID, device.points.size(), backend->sweeps.totalPoints());
+			if (!device.error.empty()) {
+				ImGui::SameLine();
+				ImGui::TextColored(RED, "%s", device.error.c_str());
+			}
+
+			if (settings.second) {
+				drawHeatmap(device, settings);
+			}
+			else {
+				drawTable(device, settings);
+			}
+		}
+	}
+
+	void drawTable(const SweepRunner::DeviceSweep& device, const SweepSettings& settings) {
+		ImGui::PushID(device.odriveID);
+		ImGui::Columns(3, "SweepTable");
+		ImGui::Text("%s", settings.first.identifier.c_str());
+		ImGui::NextColumn();
+		ImGui::Text("Value");
+		ImGui::NextColumn();
+		ImGui::Text("Rate [Hz]");
+		ImGui::NextColumn();
+		ImGui::Separator();
+		for (auto& point : device.points) {
+			ImGui::Text("%.4f", settings.first.value(point.firstStep));
+			ImGui::NextColumn();
+			point.success ? ImGui::Text("%.5g", metricValue(point)) : ImGui::TextColored(RED, "failed");
+			ImGui::NextColumn();
+			ImGui::Text("%.0f", point.rate);
+			ImGui::NextColumn();
+		}
+		ImGui::Columns(1);
+		ImGui::PopID();
+	}
+
+	// First parameter along the rows, second along the columns, blue is the lowest value and red the highest
+	void drawHeatmap(const SweepRunner::DeviceSweep& device, const SweepSettings& settings) {
+		double low = INFINITY;
+		double high = -INFINITY;
+		for (auto& point : device.points) {
+			double value = metricValue(point);
+			if (!std::isnan(value)) {
+				low = std::min(low, value);
+				high = std::max(high, value);
+			}
+		}
+
+		ImDrawList* drawList = ImGui::GetWindowDrawList();
+		ImVec2 origin = ImGui::GetCursorScreenPos();
+		for (auto& point : device.points) {
+			ImVec2 min = { origin.x + point.secondStep * SWEEP_HEATMAP_CELL, origin.y + point.firstStep * SWEEP_HEATMAP_CELL };
+			ImVec2 max = { min.x + SWEEP_HEATMAP_CELL - 1, min.y + SWEEP_HEATMAP_CELL - 1 };
+			double value = metricValue(point);
+			ImVec4 color = { 0.3f, 0.3f, 0.3f, 1.f };
+			if (!std::isnan(value)) {
+				float t = high > low ? (float)((value - low) / (high - low)) : 0.5f;
+				color = { t, 0.2f, 1.f - t, 1.f };
+			}
+			drawList->AddRectFilled(min, max, ImGui::ColorConvertFloat4ToU32(color));
+		}
+		ImGui::Dummy({ (float)settings.second->steps * SWEEP_HEATMAP_CELL, (float)settings.first.steps * SWEEP_HEATMAP_CELL });
+		if (high >= low) {
+			ImGui::Text("Rows: %s %.4g to %.4g, columns: %s %.4g to %.4g, values %.5g to %.5g",
+				settings.first.identifier.c_str(), settings.first.from, settings.first.to,
+				settings.second->identifier.c_str(), settings.second->from, settings.second->to, low, high);
+		}
+	}
+};
@@ -0,0 +1,107 @@
+#pragma once
+
+#include "pch.h"
+#include "DeviceRegistry.h"
+#include "LatencyHistogram.h"
+#include "RequestBatch.h"
+
+#include <condition_variable>
+
+#define SYNC_WAKE_LEAD 0.002		// Workers are woken this long before the send time
+#define SYNC_SPIN_TIME 0.0005		// and spin for the last part of it instead of sleeping
+
+// One synchronized transaction across all devices of a group
+struct SyncSample {
+	bool success = false;						// Every device answered completely
+	std::vector<SampleTime> times;				// One per device, for the whole batch
+	std::vector<std::vector<double>> values;	// Per device, one per identifier. Only filled by reads.
+	double sendSkew = 0.0;						// Spread of the send times over all devices
+	double skew = 0.0;							// Spread of the estimated sample times
+};
+
+// Issues the same batch of reads or writes to several devices at the same moment. Every device
+// has its own worker thread, so the transfers run concurrently instead of one after the other.
+// The workers are woken shortly before the agreed send time and spin for the last part of the
+// wait, which lines the sends up as closely as the host scheduler allows. What was achieved is
+// measured from the send and receive times of every device and reported as the skew.
+class SyncGroup {
+public:
+
+	struct Stats {
+		uint64_t samples = 0;
+		uint64_t failed = 0;			// Transactions where at least one device did not answer
+		double meanSkew = 0.0;
+		double maxSkew = 0.0;
+		double meanSendSkew = 0.0;
+		double maxSendSkew = 0.0;
+	};
+
+	// Writes must be floats. Missing devices or endpoints make the group invalid.
+	SyncGroup(const DeviceRegistry& registry, const std::vector<int>& odriveIDs, const std::vector<std::string>& identifiers, bool write = false);
+	~SyncGroup();
+
+	SyncGroup(const SyncGroup&) = delete;
+	SyncGroup& operator=(const SyncGroup&) = delete;
+
+	bool valid() const {
+		return isValid;
+	}
+
+	const std::vector<int>& devices() const {
+		return odriveIDs;
+	}
+
+	const std::vector<std::string>& channels() const {
+		return identifiers;
+	}
+
+	// Reads every identifier from every device at the same moment
+	bool read(SyncSample& sample);
+
+	// Writes values[device][identifier] to every device at the same moment
+	bool write(const std::vector<std::vector<float>>& values, SyncSample& sample);
+
+	// Synchronized reads on an absolute schedule, a rate of 0 reads as fast as possible.
+	// The samples are appended. Returns false if a device stopped answering.
+	bool run(double duration, double rate, std::vector<SyncSample>& samples, const std::atomic<bool>* abort = nullptr);
+
+	Stats stats() const;
+
+	// Skew of every transaction
+	const LatencyHistogram& skewHistogram() const {
+		return skews;
+	}
+
+private:
+	using clock = std::chrono::steady_clock;
+
+	struct Worker {
+		std::shared_ptr<ODrive> odrive;
+		RequestBatch batch;
+		std::thread thread;
+		bool success = false;
+	};
+
+	bool transact(clock::time_point sendTime, SyncSample& sample);
+	void workerLoop(Worker& worker);
+
+	std::vector<int> odriveIDs;
+	std::vector<std::string> identifiers;
+	bool writes = false;
+	bool isValid = false;
+	std::vector<std::unique_ptr<Worker>> workers;
+
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::condition_variable done;
+	uint64_t generation = 0;
+	size_t finished = 0;
+	clock::time_point scheduled;
+	bool quit = false;
+
+	LatencyHistogram skews;
+	mutable std::mutex statsMutex;
+	Stats currentStats;
+	double skewSum = 0.0;
+	double sendSkewSum = 0.0;
+};
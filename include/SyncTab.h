@@ -0,0 +1,172 @@
+#pragma once
+
+#include "pch.h"
+#include "config.h"
+#include "Backend.h"
+#include "SyncGroup.h"
+#include "SweepTab.h"
+
+#include <future>
+#include <set>
+
+// Graph panel tab for synchronized reads and writes across several devices and the skew they achieved
+class SyncTab {
+
+	struct Capture {
+		std::vector<int> odriveIDs;
+		std::vector<std::string> channels;
+		std::vector<SyncSample> samples;
+		SyncGroup::Stats stats;
+		double medianSkew = 0.0;
+		double p99Skew = 0.0;
+		bool valid = false;
+	};
+
+	std::array<char, IMGUI_BUFFER_SIZE + 1> channelList = { "axis0.encoder.pos_estimate" };
+	std::array<char, IMGUI_BUFFER_SIZE + 1> setpointIdentifier = { "axis0.controller.input_pos" };
+	float setpoint = 0.f;
+	float duration = 1.f;
+	float rate = 1000.f;
+	std::set<int> devicesSelected;
+
+	std::future<Capture> pending;
+	Capture lastCapture;
+	std::string writeResult;
+
+public:
+
+	void draw() {
+		for (auto& odrive : backend->odrives.list()) {
+			bool selected = devicesSelected.count(odrive->odriveID) > 0;
+			if (ImGui::Checkbox(("odrv" + std::to_string(odrive->odriveID) + "##sync").c_str(), &selected)) {
+				selected ? (void)devicesSelected.insert(odrive->odriveID) : (void)devicesSelected.erase(odrive->odriveID);
+			}
+			ImGui::SameLine();
+		}
+		ImGui::NewLine();
+
+		ImGui::PushItemWidth(350);
+		ImGui::InputText("Channels, comma separated##sync", channelList.data(), IMGUI_BUFFER_SIZE);
+		ImGui::PopItemWidth();
+		ImGui::PushItemWidth(150);
+		ImGui::InputFloat("Duration [s]##sync", &duration);
+		ImGui::SameLine();
+		ImGui::InputFloat("Rate [Hz], 0 = max##sync", &rate);
+		ImGui::PopItemWidth();
+
+		if (pending.valid()) {
+			if (pending.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+				lastCapture = pending.get();
+			}
+			else {
+				ImGui::TextColored(YELLOW, "Sampling...");
+				return;
+			}
+		}
+
+		if (ImGui::Button("Sample synchronized") && !devicesSelected.empty()) {
+			std::vector<int> ids(devicesSelected.begin(), devicesSelected.end());
+			auto channels = SweepTab::splitChannels(channelList.data());
+			double seconds = duration;
+			double samplesPerSecond = rate;
+			pending = backend->ioPool.async([ids, channels, seconds, samplesPerSecond] {
+				Capture capture;
+				capture.odriveIDs = ids;
+				capture.channels = channels;
+				SyncGroup group(backend->odrives, ids, channels);
+				capture.valid = group.valid();
+				if (capture.valid) {
+					group.run(seconds, samplesPerSecond, capture.samples);
+					capture.stats = group.stats();
+					capture.medianSkew = group.skewHistogram().percentile(0.5);
+					capture.p99Skew = group.skewHistogram().percentile(0.99);
+				}
+				return capture;
+			});
+		}
+
+		ImGui::PushItemWidth(350);
+		ImGui::InputText("Setpoint##sync", setpointIdentifier.data(), IMGUI_BUFFER_SIZE);
+		ImGui::PopItemWidth();
+		ImGui::SameLine();
+		ImGui::PushItemWidth(150);
+		ImGui::InputFloat("Value##sync", &setpoint);
+		ImGui::PopItemWidth();
+		ImGui::SameLine();
+		if (ImGui::Button("Apply to all") && !devicesSelected.empty()) {
+			applySetpoint();
+		}
+		if (!writeResult.empty()) {
+			ImGui::Text("%s", writeResult.c_str());
+		}
+
+		ImGui::Separator();
+		drawCapture();
+	}
+
+private:
+	void applySetpoint() {
+		std::vector<int> ids(devicesSelected.begin(), devicesSelected.end());
+		SyncGroup group(backend->odrives, ids, { setpointIdentifier.data() }, true);
+		SyncSample sample;
+		if (!group.valid() || !group.write(std::vector<std::vector<float>>(ids.size(), { setpoint }), sample)) {
+			writeResult = "The synchronized write failed, see the log";
+			return;
+		}
+		writeResult = fmt::format("Written to {} devices, send skew {:.1f} us, estimated skew {:.1f} us",
+			ids.size(), sample.sendSkew * 1e6, sample.skew * 1e6);
+	}
+
+	void drawCapture() {
+		const Capture& capture = lastCapture;
+		if (!capture.valid) {
+			if (!capture.odriveIDs.empty()) {
+				ImGui::TextColored(RED, "The channels can't be read from every device, see the log");
+			}
+			return;
+		}
+
+		const SyncGroup::Stats& stats = capture.stats;
+		ImGui::Text("%llu synchronized samples, %llu failed", (unsigned long long)stats.samples, (unsigned long long)stats.failed);
+		ImGui::Text("Estimated skew: mean %.1f us, p50 %.1f us, p99 %.1f us, max %.1f us",
+			stats.meanSkew * 1e6, capture.medianSkew * 1e6, capture.p99Skew * 1e6, stats.maxSkew * 1e6);
+		ImGui::Text("Send skew: mean %.1f us, max %.1f us", stats.meanSendSkew * 1e6, stats.maxSendSkew * 1e6);
+
+		if (capture.samples.empty() || !capture.samples.back().success)
+			return;
+
+		// The last sample, with every device's timing relative to the first one
+		const SyncSample& sample = capture.samples.back();
+		ImGui::Columns((int)capture.channels.size() + 4, "SyncSample");
+		ImGui::Text("Device");
+		ImGui::NextColumn();
+		for (auto& channel : capture.channels) {
+			ImGui::Text("%s", channel.c_str());
+			ImGui::NextColumn();
+		}
+		ImGui::Text("Sent [us]");
+		ImGui::NextColumn();
+		ImGui::Text("Round trip [us]");
+		ImGui::NextColumn();
+		ImGui::Text("Estimate [us]");
+		ImGui::NextColumn();
+
+		const SampleTime& reference = sample.times.front();
+		for (size_t i = 0; i < capture.odriveIDs.size(); i++) {
+			const SampleTime& time = sample.times[i];
+			ImGui::Text("odrv%d", capture.odriveIDs[i]);
+			ImGui::NextColumn();
+			for (double value : sample.values[i]) {
+				ImGui::Text("%.4f", value);
+				ImGui::NextColumn();
+			}
+			ImGui::Text("%+.1f", (time.sent - reference.sent) * 1e6);
+			ImGui::NextColumn();
+			ImGui::Text("%.1f", time.roundTrip() * 1e6);
+			ImGui::NextColumn();
+			ImGui::Text("%+.1f", (time.sampled - reference.sampled) * 1e6);
+			ImGui::NextColumn();
+		}
+		ImGui::Columns(1);
+	}
+};
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "pch.h"
+
+#include <deque>
+#include <future>
+
+// Fixed-size pool of worker threads with one task queue per worker. A worker takes its own newest
+// task first and steals the oldest task of another worker when it runs dry, so bursts of small
+// jobs spread out without all threads fighting over one queue. Tasks submitted from a worker
+// go to that worker's queue, others are distributed round-robin.
+class ThreadPool {
+public:
+
+	struct Stats {
+		size_t threads = 0;
+		size_t queued = 0;		// Tasks currently waiting
+		size_t submitted = 0;
+		size_t executed = 0;
+		size_t stolen = 0;		// Tasks executed by a worker they were not queued on
+	};
+
+	ThreadPool(const std::string& name, size_t threadCount);
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	// Runs what is queued, then joins the workers. Tasks submitted afterwards are never run.
+	void stop();
+
+	void submit(std::function<void()> task);
+
+	template<typename F>
+	auto async(F&& function) -> std::future<decltype(function())> {
+		auto task = std::make_shared<std::packaged_task<decltype(function())()>>(std::forward<F>(function));
+		auto future = task->get_future();
+		submit([task] { (*task)(); });
+		return future;
+	}
+
+	Stats stats() const;
+	size_t size() const {
+		return workers.size();
+	}
+
+private:
+	struct Worker {
+		std::deque<std::function<void()>> tasks;
+		std::mutex mutex;
+		std::thread thread;
+		std::atomic<size_t> executed = 0;
+		std::atomic<size_t> stolen = 0;
+	};
+
+	void workerThread(size_t index);
+	bool takeTask(size_t index, std::function<void()>& task);
+
+	std::string name;
+	std::vector<std::unique_ptr<Worker>> workers;
+	std::atomic<size_t> nextWorker = 0;
+	std::atomic<size_t> pending = 0;
+	std::atomic<size_t> submitted = 0;
+	std::atomic<bool> stopping = false;
+
+	std::mutex sleepMutex;
+	std::condition_variable wakeup;
+};
@@ -0,0 +1,105 @@
+#pragma once
+
+#include "pch.h"
+#include "DeviceRegistry.h"
+#include "LatencyHistogram.h"
+#include "RequestBatch.h"
+
+#define PLAYER_START_DELAY 0.05			// Seconds between start() and the first setpoint
+#define PLAYER_SPIN_TIME 0.0005			// The last part of every wait is spent spinning instead of sleeping
+#define PLAYER_LATE_THRESHOLD 0.001		// A setpoint sent later than this counts as late
+#define PLAYER_REALTIME_PRIORITY 80		// SCHED_FIFO priority on Linux
+
+// Timestamped setpoints from a CSV file. The header names the targets, every following line
+// is the time in seconds and one value per target:
+//
+//     time,odrv0.axis0.controller.input_pos,odrv1.axis0.controller.input_pos
+//     0.000,0.0,0.0
+//     0.001,0.002,-0.002
+struct Trajectory {
+
+	struct Target {
+		int odriveID = 0;
+		std::string identifier;
+	};
+
+	std::vector<Target> targets;
+	std::vector<double> times;					// Increasing
+	std::vector<std::vector<float>> values;		// One column per target
+
+	double duration() const {
+		return times.empty() ? 0.0 : times.back() - times.front();
+	}
+
+	// The file is memory mapped and parsed in place
+	static std::optional<Trajectory> Load(const std::string& path, std::string& error);
+};
+
+// Streams a trajectory to its devices from a dedicated thread. The schedule is absolute, every
+// setpoint goes out at the start time plus its own timestamp, so late samples never shift the
+// ones after them. Each device gets one pre-encoded batch of writes which is patched per sample.
+class TrajectoryPlayer {
+public:
+
+	struct Options {
+		bool realtime = false;		// SCHED_FIFO on Linux, time critical priority on Windows
+		int cpu = -1;				// Pin the thread to this CPU, -1 to let the OS decide
+	};
+
+	// Jitter is measured per device write, from the scheduled time of the sample to the moment
+	// the write actually went out. Devices later in a sample include the time spent on the others.
+	struct DeviceStats {
+		int odriveID = 0;
+		size_t late = 0;			// Writes sent more than PLAYER_LATE_THRESHOLD after their time
+		size_t failed = 0;			// Writes that could not be sent
+		double meanJitter = 0.0;	// Seconds between the scheduled and the actual send time
+		double maxJitter = 0.0;
+	};
+
+	struct Stats {
+		size_t sent = 0;			// Samples
+		size_t total = 0;
+		size_t late = 0;			// Device writes, all devices together
+		size_t failed = 0;
+		double meanJitter = 0.0;
+		double maxJitter = 0.0;
+		std::vector<DeviceStats> devices;
+	};
+
+	TrajectoryPlayer(const DeviceRegistry& registry) : registry(registry) {}
+	~TrajectoryPlayer();
+
+	// Fails if a target is not a writable float of a connected device
+	bool start(std::shared_ptr<const Trajectory> trajectory, const Options& options, std::string& error);
+	void stop();
+
+	bool running() const {
+		return isRunning;
+	}
+
+	Stats stats() const;
+
+	// Send jitter of every device write, only valid while no one calls start()
+	const LatencyHistogram& jitter() const {
+		return *jitterHistogram;
+	}
+
+private:
+	// One batch of writes per device, the values are patched in for every sample
+	struct DeviceStream {
+		std::shared_ptr<ODrive> odrive;
+		RequestBatch batch;
+		std::vector<std::pair<size_t, size_t>> columns;		// Trajectory column, request index
+	};
+
+	void playLoop(std::shared_ptr<const Trajectory> trajectory, std::vector<DeviceStream> devices, Options options);
+	static void ConfigureThread(const Options& options);
+
+	const DeviceRegistry& registry;
+	std::thread thread;
+	std::atomic<bool> isRunning = false;
+	std::unique_ptr<LatencyHistogram> jitterHistogram = std::make_unique<LatencyHistogram>();
+
+	mutable std::mutex statsMutex;
+	Stats currentStats;
+};
@@ -0,0 +1,82 @@
+#pragma once
+
+#include "pch.h"
+#include "LatencyHistogram.h"
+
+// Lower value = more important. A waiting request of a class is always served before any
+// waiting request of a less important class.
+enum class TransferPriority {
+	SAFETY,			// Stop commands and the watchdog
+	INTERACTIVE,	// Anything the user is waiting for, like a click on "Set"
+	POLL,			// Periodic updates of the control panel, streaming, waiting for states
+	BACKGROUND,		// Bulk transfers like reading every endpoint of a device
+	COUNT
+};
+
+inline const char* TransferPriorityName(TransferPriority priority) {
+	switch (priority) {
+	case TransferPriority::SAFETY:		return "Safety";
+	case TransferPriority::INTERACTIVE:	return "Interactive";
+	case TransferPriority::POLL:		return "Poll";
+	case TransferPriority::BACKGROUND:	return "Background";
+	}
+	return "Unknown";
+}
+
+// Every transfer made by this thread uses this priority while the scope exists. Without a scope,
+// transfers are INTERACTIVE. Jobs on thread pools must open their own scope.
+class TransferPriorityScope {
+public:
+	TransferPriorityScope(TransferPriority priority) : previous(current) {
+		current = priority;
+	}
+
+	~TransferPriorityScope() {
+		current = previous;
+	}
+
+	static TransferPriority get() {
+		return current;
+	}
+
+private:
+	TransferPriority previous;
+	inline static thread_local TransferPriority current = TransferPriority::INTERACTIVE;
+};
+
+// Grants exclusive access to one device link, replacing a plain mutex. When the link is released,
+// the most important waiting class gets it next, and long batches give it up between requests
+// as soon as something more important is waiting. Time from asking for the link until releasing
+// it is recorded per class.
+class TransferArbiter {
+public:
+
+	void acquire(TransferPriority priority);
+	bool tryAcquire(TransferPriority priority);
+	void release();
+
+	// True if a more important class is waiting, checked by batches between requests
+	bool higherWaiting(TransferPriority priority) const {
+		for (size_t i = 0; i < (size_t)priority; i++) {
+			if (waiting[i] > 0)
+				return true;
+		}
+		return false;
+	}
+
+	const LatencyHistogram& latency(TransferPriority priority) const {
+		return histograms[(size_t)priority];
+	}
+
+	void recordLatency(TransferPriority priority, double seconds) {
+		histograms[(size_t)priority].record(seconds);
+	}
+
+private:
+	std::mutex mutex;
+	std::array<std::condition_variable, (size_t)TransferPriority::COUNT> wakeups;
+	std::array<std::atomic<int>, (size_t)TransferPriority::COUNT> waiting = {};
+	bool busy = false;
+
+	std::array<LatencyHistogram, (size_t)TransferPriority::COUNT> histograms;
+};
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "pch.h"
+#include "libusbcpp.h"
+
+#define ODRIVE_VENDOR_ID 0x1209
+#define ODRIVE_PRODUCT_ID 0x0D32
+
+#define ODRIVE_USB_INTERFACE 2
+#define ODRIVE_USB_READ_ENDPOINT (uint16_t)0x83
+#define ODRIVE_USB_WRITE_ENDPOINT (uint16_t)0x03
+
+typedef std::vector<uint8_t> buffer_t;
+
+// Moves raw protocol packets between the host and a single ODrive
+class Transport {
+public:
+	virtual ~Transport() = default;
+
+	virtual bool write(const uint8_t* data, size_t length) = 0;		// Returns false if the packet could not be sent
+	virtual buffer_t read(size_t maxLength) = 0;					// Returns an empty buffer on failure
+};
+
+class UsbTransport : public Transport {
+public:
+
+	UsbTransport(libusbcpp::device device) : device(device) {
+		if (!device) {
+			throw std::runtime_error("ODrive device is nullptr!");
+		}
+		if (!device->claimInterface(ODRIVE_USB_INTERFACE)) {
+			throw std::runtime_error("Cannot claim USB interface");
+		}
+	}
+
+	bool write(const uint8_t* data, size_t length) override {
+		return device->bulkWrite((uint8_t*)data, length, ODRIVE_USB_WRITE_ENDPOINT) != -1;
+	}
+
+	buffer_t read(size_t maxLength) override {
+		return device->bulkRead(maxLength, ODRIVE_USB_READ_ENDPOINT);
+	}
+
+private:
+	libusbcpp::device device;
+};
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "pch.h"
+#include "DeviceRegistry.h"
+#include "ThreadPool.h"
+#include "ChangeBus.h"
+
+#define VERIFY_RESULT_DURATION 3.0		// Seconds a verification result is shown in the UI
+
+struct WriteVerification {
+	BasicEndpoint endpoint;
+	EndpointValue written;
+	EndpointValue readBack;		// INVALID if the read-back failed
+	bool acknowledged = false;	// The device answered the write itself
+	bool success = false;		// Acknowledged and the read-back equals the written value
+	double timestamp = 0.0;		// Runtime when the read-back arrived
+	double latency = 0.0;		// Seconds from write() until the read-back arrived
+};
+
+// Writes values with an ack and confirms them with a read-back. write() returns immediately,
+// everything written to a device until its I/O job runs goes out as one pipelined batch: all
+// writes with ack, then one read of every written endpoint. The results are handed to the
+// callback on the I/O pool and kept per endpoint for the UI.
+class VerifiedWriter {
+public:
+
+	typedef std::function<void(const std::vector<WriteVerification>&)> Callback;
+
+	VerifiedWriter(const DeviceRegistry& registry, ThreadPool& pool) : registry(registry), pool(pool) {}
+
+	void setCallback(Callback callback) {
+		this->callback = std::move(callback);
+	}
+
+	// A newer value for an endpoint replaces one that was not sent yet
+	void write(const BasicEndpoint& endpoint, const EndpointValue& value);
+
+	// The last result for an endpoint, if it is younger than VERIFY_RESULT_DURATION
+	std::optional<WriteVerification> recentResult(EndpointHandle handle) const;
+
+private:
+	struct PendingWrite {
+		BasicEndpoint endpoint;
+		EndpointValue value;
+		double requested = 0.0;
+	};
+
+	struct DeviceQueue {
+		std::vector<PendingWrite> writes;
+		bool scheduled = false;		// An I/O job for this device is queued or running
+	};
+
+	void flush(int odriveID);
+
+	const DeviceRegistry& registry;
+	ThreadPool& pool;
+	Callback callback;
+
+	mutable std::mutex mutex;
+	std::unordered_map<int, DeviceQueue> queues;
+	std::unordered_map<EndpointHandle, WriteVerification> results;
+};
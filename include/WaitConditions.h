@@ -0,0 +1,28 @@
+#pragma once
+
+#include "pch.h"
+#include "Async.h"
+#include "DeviceRegistry.h"
+
+#define WAIT_INITIAL_INTERVAL 0.02		// Seconds between the first poll rounds
+#define WAIT_MAX_INTERVAL 0.5			// The interval backs off up to this while nothing changes
+#define WAIT_BACKOFF_FACTOR 1.5
+
+struct WaitCondition {
+	int odriveID = 0;
+	std::string identifier;
+	std::function<bool(const EndpointValue&)> predicate;
+	double timeout = 10.0;
+};
+
+struct WaitResult {
+	bool met = false;				// false means timed out, or the device was not found
+	EndpointValue lastValue;
+	double elapsed = 0.0;			// Seconds until the condition was met or gave up
+};
+
+// Waits for any number of conditions on any number of devices in one poll loop. Every round
+// reads all endpoints whose conditions are still pending, one batch per device and all devices
+// in parallel. While nothing is met the interval between rounds backs off, so a rig that takes
+// a minute to calibrate causes little USB traffic. Results are in the order of the conditions.
+Task<std::vector<WaitResult>> WaitForConditions(AsyncExecutor& executor, const DeviceRegistry& registry, std::vector<WaitCondition> conditions);
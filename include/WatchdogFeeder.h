@@ -0,0 +1,88 @@
+#pragma once
+
+#include "pch.h"
+#include "DeviceRegistry.h"
+#include "LatencyHistogram.h"
+#include "RequestBatch.h"
+
+#define WATCHDOG_DEFAULT_PERIOD 0.05		// Seconds between feeds
+#define WATCHDOG_SPIN_TIME 0.002			// The last part of every wait is spent spinning instead of sleeping
+#define WATCHDOG_ALARM_FRACTION 0.5			// Alarm when the last confirmed feed is older than this part of the timeout
+
+struct WatchdogAxis {
+	int odriveID = 0;
+	int axis = 0;
+};
+
+// Feeds the axis watchdogs of selected axes from dedicated threads, one per device, instead of the
+// shared update thread. Every feed goes out in the SAFETY lane on an absolute schedule and is sent
+// together with a read of the axis error, whose response confirms the feed and shows whether the
+// watchdog expired anyway. A monitor thread watches the age of the last confirmed feed and raises
+// an alarm well before the axis timeout, even while a feeding thread is stuck in a transfer.
+class WatchdogFeeder {
+public:
+
+	struct AxisStatus {
+		WatchdogAxis axis;
+		double timeout = 0.0;		// watchdog_timeout of the axis, 0 if its watchdog is disabled
+		uint64_t feeds = 0;			// Confirmed by the device
+		uint64_t failed = 0;
+		double lastFeed = 0.0;		// Runtime when the device handled the last confirmed feed
+		double maxGap = 0.0;		// Longest time between two confirmed feeds
+		bool alarm = false;			// The last confirmed feed is older than WATCHDOG_ALARM_FRACTION of the timeout
+		bool expired = false;		// The axis reports AXIS_ERROR_WATCHDOG_TIMER_EXPIRED
+	};
+
+	struct Stats {
+		uint64_t ticks = 0;
+		double meanJitter = 0.0;	// Seconds between the scheduled feed and the moment the device handled it
+		double maxJitter = 0.0;
+	};
+
+	WatchdogFeeder(const DeviceRegistry& registry) : registry(registry) {}
+	~WatchdogFeeder();
+
+	// Axes whose device is missing or has no watchdog are skipped
+	bool start(const std::vector<WatchdogAxis>& axes, double period = WATCHDOG_DEFAULT_PERIOD);
+	void stop();
+
+	bool running() const {
+		return isRunning;
+	}
+
+	double period() const {
+		return feedPeriod;
+	}
+
+	std::vector<AxisStatus> status() const;
+	Stats stats() const;
+
+	// Feed jitter of every tick, only valid while no one calls start()
+	const LatencyHistogram& jitter() const {
+		return *jitterHistogram;
+	}
+
+private:
+	struct Device {
+		std::shared_ptr<ODrive> odrive;
+		RequestBatch batch;
+		std::vector<std::pair<size_t, size_t>> axes;		// Status index, request index of the error read
+		std::thread thread;
+	};
+
+	void feedLoop(Device& device);
+	void monitorLoop();
+
+	const DeviceRegistry& registry;
+	std::vector<std::unique_ptr<Device>> devices;
+	std::thread monitor;
+	std::atomic<bool> isRunning = false;
+	double feedPeriod = WATCHDOG_DEFAULT_PERIOD;
+	double monitorInterval = WATCHDOG_DEFAULT_PERIOD;	// Often enough to alarm in time for the shortest timeout
+	std::unique_ptr<LatencyHistogram> jitterHistogram = std::make_unique<LatencyHistogram>();
+
+	mutable std::mutex statusMutex;
+	std::vector<AxisStatus> axisStatus;
+	Stats currentStats;
+	double jitterSum = 0.0;
+};
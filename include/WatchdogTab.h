@@ -0,0 +1,88 @@
+#pragma once
+
+#include "pch.h"
+#include "config.h"
+#include "Backend.h"
+
+#include <set>
+
+// Graph panel tab for the watchdog feeder: axis selection, feed timing and the state of every watchdog
+class WatchdogTab {
+
+	std::set<std::pair<int, int>> axesSelected;		// odriveID, axis
+	float periodMs = WATCHDOG_DEFAULT_PERIOD * 1000.0f;
+
+public:
+
+	void draw() {
+		WatchdogFeeder& watchdog = backend->watchdog;
+		if (watchdog.running()) {
+			if (ImGui::Button("Stop feeding")) {
+				watchdog.stop();
+			}
+			ImGui::SameLine();
+			ImGui::Text("Feeding every %.1f ms", watchdog.period() * 1000.0);
+		}
+		else {
+			drawSettings();
+		}
+
+		WatchdogFeeder::Stats stats = watchdog.stats();
+		if (stats.ticks == 0)
+			return;
+
+		ImGui::Separator();
+		const LatencyHistogram& jitter = watchdog.jitter();
+		ImGui::Text("%llu ticks, feed jitter: mean %.3f ms, p99 %.3f ms, max %.3f ms", (unsigned long long)stats.ticks,
+			stats.meanJitter * 1000.0, jitter.percentile(0.99) * 1000.0, stats.maxJitter * 1000.0);
+
+		double now = Battery::GetRuntime();
+		for (auto& status : watchdog.status()) {
+			ImGui::Text("odrv%d axis%d:", status.axis.odriveID, status.axis.axis);
+			ImGui::SameLine();
+			if (status.expired) {
+				ImGui::TextColored(RED, "EXPIRED");
+			}
+			else if (status.alarm) {
+				ImGui::TextColored(YELLOW, "FEED OVERDUE");
+			}
+			else if (status.timeout <= 0.0) {
+				ImGui::TextDisabled("disabled");
+			}
+			else {
+				ImGui::TextColored(GREEN, "OK");
+			}
+			ImGui::SameLine();
+			ImGui::Text("timeout %.0f ms, %llu feeds, %llu failed, last %.1f ms ago, longest gap %.1f ms", status.timeout * 1000.0,
+				(unsigned long long)status.feeds, (unsigned long long)status.failed, (now - status.lastFeed) * 1000.0, status.maxGap * 1000.0);
+		}
+	}
+
+private:
+	void drawSettings() {
+		for (auto& odrive : backend->odrives.list()) {
+			for (int axis = 0; axis < 2; axis++) {
+				std::pair<int, int> key = { odrive->odriveID, axis };
+				bool selected = axesSelected.count(key) > 0;
+				std::string label = "odrv" + std::to_string(odrive->odriveID) + ".axis" + std::to_string(axis) + "##watchdog";
+				if (ImGui::Checkbox(label.c_str(), &selected)) {
+					selected ? (void)axesSelected.insert(key) : (void)axesSelected.erase(key);
+				}
+				ImGui::SameLine();
+			}
+		}
+		ImGui::NewLine();
+
+		ImGui::PushItemWidth(150);
+		ImGui::InputFloat("Feed period [ms]", &periodMs);
+		ImGui::PopItemWidth();
+
+		if (ImGui::Button("Start feeding") && !axesSelected.empty()) {
+			std::vector<WatchdogAxis> axes;
+			for (auto& [odriveID, axis] : axesSelected) {
+				axes.push_back({ odriveID, axis });
+			}
+			backend->watchdog.start(axes, periodMs / 1000.0);
+		}
+	}
+};
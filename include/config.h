@@ -6,6 +6,8 @@
 #define ODRIVE_POPUP_HEIGHT 370
 #define ENDPOINT_SELECTOR_WIDTH 400
 
+#define CHANGE_HIGHLIGHT_DURATION 0.2	// Seconds a value is drawn red after it changed
+
 #define RED			IMGUI_COLOR(255, 0, 0, 255)
 #define GREEN		IMGUI_COLOR(0, 255, 0, 255)
 #define BLUE		IMGUI_COLOR(0, 0, 255, 255)
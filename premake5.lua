@@ -27,7 +27,7 @@ include "modules/libusbcpp"
 -- Actual application project
 project (projectName)
     language "C++"
-	cppdialect "C++17"
+	cppdialect "C++20"
 	staticruntime "on"
     location "build"
     targetname (projectName)
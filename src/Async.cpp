@@ -0,0 +1,78 @@
+
+#include "pch.h"
+#include "Async.h"
+
+namespace {
+
+	// Owns itself, the frame is destroyed as soon as the coroutine finishes
+	struct DetachedTask {
+		struct promise_type {
+			DetachedTask get_return_object() { return {}; }
+			std::suspend_never initial_suspend() noexcept { return {}; }
+			std::suspend_never final_suspend() noexcept { return {}; }
+			void return_void() {}
+			void unhandled_exception() {}
+		};
+	};
+
+	DetachedTask runDetached(Task<void> task, std::atomic<size_t>& activeTasks) {
+		try {
+			co_await task;
+		}
+		catch (const std::exception& e) {
+			LOG_ERROR("Uncaught exception in coroutine: {}", e.what());
+		}
+		activeTasks--;
+	}
+}
+
+AsyncExecutor::AsyncExecutor(ThreadPool& pool) : pool(pool) {
+	timer = std::thread(std::bind(&AsyncExecutor::timerThread, this));
+}
+
+AsyncExecutor::~AsyncExecutor() {
+	{
+		std::lock_guard<std::mutex> lock(timerMutex);
+		stopTimer = true;
+	}
+	timerChanged.notify_all();
+	timer.join();
+
+	if (activeTasks > 0) {
+		LOG_WARN("{} coroutines were still running when the executor stopped", activeTasks);
+	}
+}
+
+void AsyncExecutor::spawn(Task<void> task) {
+	activeTasks++;
+	runDetached(std::move(task), activeTasks);
+}
+
+void AsyncExecutor::resumeAt(double runtime, std::coroutine_handle<> handle) {
+	{
+		std::lock_guard<std::mutex> lock(timerMutex);
+		timers.emplace(runtime, handle);
+	}
+	timerChanged.notify_all();
+}
+
+void AsyncExecutor::timerThread() {
+	std::unique_lock<std::mutex> lock(timerMutex);
+	while (!stopTimer) {
+		if (timers.empty()) {
+			timerChanged.wait(lock);
+			continue;
+		}
+
+		double now = Battery::GetRuntime();
+		auto next = timers.begin();
+		if (next->first > now) {
+			timerChanged.wait_for(lock, std::chrono::duration<double>(next->first - now));
+			continue;
+		}
+
+		std::coroutine_handle<> handle = next->second;
+		timers.erase(next);
+		pool.submit([handle] { handle.resume(); });
+	}
+}
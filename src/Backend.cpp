@@ -3,10 +3,13 @@
 #include "Backend.h"
 
 #include "Endpoint.h"
+#include "EmulatedODrive.h"
+#include "AsyncODrive.h"
 
 std::unique_ptr<Backend> backend;
 
-Backend::Backend() {
+Backend::Backend() : ioPool("io", IO_POOL_THREADS), cpuPool("cpu", std::thread::hardware_concurrency()), stopPool("stop", STOP_POOL_THREADS), executor(ioPool), calibration(executor, odrives), sampler(odrives), verifiedWriter(odrives, ioPool), fleetPush(odrives, executor), sweeps(odrives), player(odrives), watchdog(odrives) {
+	verifiedWriter.setCallback([this](const std::vector<WriteVerification>& results) { writesVerified(results); });
 	importEntries(Battery::GetExecutableDirectory() + "endpoints.json");
 	usbListener = std::thread(std::bind(&Backend::listenerThread, this));
 }
@@ -16,6 +19,13 @@ Backend::~Backend() {
 	stopListener = true;
 	LOG_DEBUG("Waiting for USB listener to join");
 	usbListener.join();
+
+	// Jobs still queued resume coroutines and use the members below, so they must finish while
+	// all of them still exist. Coroutines asleep in the executor at this point are abandoned.
+	LOG_DEBUG("Waiting for the thread pools to drain");
+	ioPool.stop();
+	cpuPool.stop();
+	stopPool.stop();
 }
 
 void Backend::listenerThread() {
@@ -28,89 +38,129 @@ void Backend::listenerThread() {
 				std::shared_ptr<ODrive> odrive = std::make_shared<ODrive>(device);
 				odrive->getSerialNumber();
 
-				while (deviceWaiting) {
-					Battery::Sleep(USB_SCAN_INTERVAL);
-				}
-				std::lock_guard<std::mutex> lock(temporaryDeviceMutex);
-				temporaryDevice = odrive;
-				deviceWaiting = true;
+				std::lock_guard<std::mutex> lock(newDevicesMutex);
+				newDevices.push_back(odrive);
 			}
 			catch (const std::exception& e) {
 				LOG_ERROR("Failed to connect device: {}", e.what());
 			}
 		}
-		Battery::Sleep(USB_SCAN_INTERVAL);
-	}
-}
-
-void Backend::handleNewDevices() {
-	if (deviceWaiting) {
-		std::lock_guard<std::mutex> lock(temporaryDeviceMutex);
-		connectDevice(temporaryDevice);
-		temporaryDevice.reset();
-		deviceWaiting = false;
-	}
-}
-
-void Backend::connectDevice(std::shared_ptr<ODrive> odrv) {
 
-	// Check if a device with the same serial number is already known
-	int index = -1;
-	for (int i = 0; i < MAX_NUMBER_OF_ODRIVES; i++) {
-		if (odrives[i]) {
-			if (odrives[i]->serialNumber == odrv->serialNumber) {
-				index = i;
-				break;
+		std::vector<std::shared_ptr<EmulatedTransport>> rebooted;
+		{
+			std::lock_guard<std::mutex> lock(newDevicesMutex);
+			for (auto& transport : emulatedDevices) {
+				if (auto next = transport->rebooted()) {
+					transport = next;
+					rebooted.push_back(next);
+				}
 			}
 		}
-	}
+		for (auto& transport : rebooted) {
+			try {
+				LOG_DEBUG("Emulated device is back after a reboot, probing...");
+				std::shared_ptr<ODrive> odrive = std::make_shared<ODrive>(transport);
+				odrive->getSerialNumber();
 
-	if (index == -1) {	// Device is not known yet, choose an empty slot
-		for (int i = 0; i < MAX_NUMBER_OF_ODRIVES; i++) {
-			if (!odrives[i]) {
-				index = i;
-				break;
+				std::lock_guard<std::mutex> lock(newDevicesMutex);
+				newDevices.push_back(odrive);
+			}
+			catch (const std::exception& e) {
+				LOG_ERROR("Failed to reconnect emulated device: {}", e.what());
 			}
 		}
+		Battery::Sleep(USB_SCAN_INTERVAL);
 	}
+}
 
-	if (index == -1) {
-		LOG_ERROR("Device can't be connected: No slot is available!");
-		return;
+void Backend::handleNewDevices() {
+	std::vector<std::shared_ptr<ODrive>> devices;
+	{
+		std::lock_guard<std::mutex> lock(newDevicesMutex);
+		devices.swap(newDevices);
 	}
 
+	for (auto& odrv : devices) {
+		cpuPool.submit([this, odrv] {	// Parsing the descriptor takes a while, keep it off the UI thread
+			connectDevice(odrv);
+		});
+	}
+}
+
+void Backend::connectDevice(std::shared_ptr<ODrive> odrv) {
+
 	if (odrv->serialNumber == 0) {
 		LOG_ERROR("Device can't be connected: Cannot read serial number!");
 		return;
 	}
 
-	odrv->setODriveID(index);
+	int index = odrives.add(odrv);	// Known serial numbers get their old ID back
+	if (index == -1)
+		return;
 
-	odrives[index] = odrv;	// Transfer ownership into the odrives array
+	changeBus.resetDevice(index);
 
 	LOG_INFO("Device with serial number 0x{:08X} connected as odrv{}", odrv->serialNumber, index);
 }
 
+void Backend::connectEmulatedDevices(int count) {
+	for (int i = 0; i < count; i++) {
+		try {
+			auto transport = std::make_shared<EmulatedTransport>(EMULATED_SERIAL_NUMBER_BASE + i);
+			std::shared_ptr<ODrive> odrive = std::make_shared<ODrive>(transport);
+			odrive->getSerialNumber();
+			connectDevice(odrive);
+
+			std::lock_guard<std::mutex> lock(newDevicesMutex);
+			emulatedDevices.push_back(transport);
+		}
+		catch (const std::exception& e) {
+			LOG_ERROR("Failed to create emulated device: {}", e.what());
+		}
+	}
+}
+
 void Backend::addEntry(const Entry& entry) {
 	LOG_INFO("Adding endpoint entry {}", entry.endpoint.basic.fullPath);
-	entries.push_back(entry);
+	entries.add(entry);
 }
 
-void Backend::removeEntry(const std::string& fullPath) {
-	LOG_INFO("Removing endpoint entry {}", fullPath);
-	for (size_t i = 0; i < entries.size(); i++) {
-		if (entries[i].endpoint->fullPath == fullPath) {
-			entries.erase(entries.begin() + i);
-			return;
-		}
-	}
+void Backend::removeEntry(size_t entryID) {
+	auto entry = entries.get(entryID);
+	if (!entry)
+		return;
+
+	LOG_INFO("Removing endpoint entry {}", entry->endpoint.basic.fullPath);
+	entries.remove(entryID);
 }
 
 void Backend::updateEntryCache() {
 
-	for (Entry& e : entries) {
-		e.updateValue();
+	// Group the entries by device, edits from the UI only affect the next generation
+	std::map<int, std::vector<std::shared_ptr<Entry>>> batches;
+	for (auto& e : entries.list()) {
+		batches[e->endpoint->odriveID].push_back(e);
+	}
+
+	// Every device is polled in parallel on the I/O pool
+	std::vector<std::future<std::vector<ValueChange>>> results;
+	for (auto& [odriveID, batch] : batches) {
+		results.push_back(ioPool.async([batch = std::move(batch)] {
+			TransferPriorityScope priority(TransferPriority::POLL);
+			std::vector<ValueChange> samples;
+			for (auto& e : batch) {
+				e->updateValue(samples);
+			}
+			return samples;
+		}));
 	}
+
+	std::vector<ValueChange> samples;
+	for (auto& result : results) {
+		auto batchSamples = result.get();
+		samples.insert(samples.end(), batchSamples.begin(), batchSamples.end());
+	}
+	changeBus.publish(samples);
 }
 
 void Backend::importEntries(std::string path) {
@@ -130,13 +180,14 @@ void Backend::importEntries(std::string path) {
 	}
 
 	// Now import it
-	entries.clear();
+	std::vector<Entry> imported;
 	try {
 		njson json = njson::parse(file.content());
 		for (njson entry : json) {
 			Entry e(entry);
 			if (e.endpoint->id != -1) {
-				addEntry(e);
+				LOG_INFO("Adding endpoint entry {}", e.endpoint.basic.fullPath);
+				imported.push_back(e);
 			}
 			else {
 				LOG_WARN("Failed to import an entry: JSON definition was invalid!");
@@ -147,13 +198,14 @@ void Backend::importEntries(std::string path) {
 		LOG_ERROR("Error while importing: Not a valid JSON file!");
 		return;
 	}
+	entries.replace(imported);	// Published as one new generation
 	LOG_DEBUG("Done");
 }
 
 void Backend::exportEntries(const std::string& file) {
 	nlohmann::json json = nlohmann::json::array();
-	for (Entry& e : entries) {
-		json.push_back(e.toJson());
+	for (auto& e : entries.list()) {
+		json.push_back(e->toJson());
 	}
 	std::string content = json.dump(4);
 
@@ -170,13 +222,14 @@ void Backend::loadDefaultEntries() {
 	std::string file = DEFAULT_ENTRIES_JSON;
 
 	LOG_DEBUG("Loading default entries...");
-	entries.clear();
+	std::vector<Entry> defaults;
 	try {
 		njson json = njson::parse(file);
 		for (njson entry : json) {
 			Entry e(entry);
 			if (e.endpoint->id != -1) {
-				addEntry(e);
+				LOG_INFO("Adding endpoint entry {}", e.endpoint.basic.fullPath);
+				defaults.push_back(e);
 			}
 			else {
 				LOG_WARN("Failed to import an entry: JSON definition was invalid!");
@@ -187,15 +240,106 @@ void Backend::loadDefaultEntries() {
 		LOG_ERROR("Error while importing: Not a valid JSON file!");
 		return;
 	}
+	entries.replace(defaults);
 	LOG_DEBUG("Done");
 }
 
-void Backend::executeFunction(int odriveID, const std::string& identifier) {
+void Backend::executeFunction(int odriveID, const std::string& identifier, const std::vector<EndpointValue>& inputs) {
+
+	auto odrive = odrives.get(odriveID);
+	if (!odrive)
+		return;
+
+	ioPool.submit([this, odrive, identifier, inputs] {
+		FunctionResult result = odrive->call(identifier, inputs);
+		if (!result.success) {
+			LOG_ERROR("Calling odrv{}.{}() failed", odrive->odriveID, identifier);
+			return;
+		}
+
+		// Show the outputs right away, without waiting for the next poll
+		std::vector<ValueChange> samples;
+		std::stringstream outputs;
+		for (auto& [endpoint, value] : result.outputs) {
+			samples.push_back({ endpoint.handle(), value, SampleTime::At(Battery::GetRuntime()) });
+			outputs << " " << endpoint.name << " = " << value.toString();
+		}
+		publishReadBack(samples);
+		LOG_DEBUG("Called odrv{}.{}(){}", odrive->odriveID, identifier, outputs.str());
+	});
+}
+
+static Task<void> clearErrorsSequence(AsyncODrive drive) {
+	co_await drive.call("axis0.clear_errors");
+
+	auto odrive = drive.device();
+	co_await backend->executor.io<bool>([odrive] {		// Refresh the error flags shown in the status bar
+		odrive->updateErrors();
+		return true;
+	});
+}
 
-	if (!odrives[odriveID])
+void Backend::clearErrors(int odriveID) {
+
+	auto odrive = odrives.get(odriveID);
+	if (!odrive)
 		return;
 
-	odrives[odriveID]->executeFunction(identifier);
+	executor.spawn(clearErrorsSequence(AsyncODrive(executor, odrive)));
+}
+
+void Backend::writeEndpointVerified(const BasicEndpoint& ep, const EndpointValue& value) {
+	LOG_DEBUG("Writing {} to endpoint {} with read-back", value.toString(), ep.fullPath);
+	verifiedWriter.write(ep, value);
+}
+
+void Backend::writesVerified(const std::vector<WriteVerification>& results) {
+
+	std::vector<ValueChange> samples;
+	for (auto& result : results) {
+		if (result.readBack.type() != EndpointValueType::INVALID) {
+			samples.push_back({ result.endpoint.handle(), result.readBack, SampleTime::At(result.timestamp) });
+		}
+	}
+	publishReadBack(samples);
+}
+
+void Backend::publishReadBack(const std::vector<ValueChange>& samples) {
+	// Values read as part of a write or call are as good as a poll, so the entries show them right away
+	for (auto& entry : entries.list()) {
+		entry->applySamples(samples);
+	}
+	changeBus.publish(samples);
+}
+
+void Backend::stopAll() {
+
+	double start = Battery::GetRuntime();
+	std::vector<std::future<std::pair<bool, double>>> results;
+	for (auto& odrive : odrives.list()) {
+		if (!odrive->connected)
+			continue;
+
+		results.push_back(stopPool.async([odrive, start] {
+			bool success = odrive->stop();
+			return std::make_pair(success, Battery::GetRuntime() - start);
+		}));
+	}
+
+	double worst = 0.0;
+	size_t failed = 0;
+	for (auto& result : results) {
+		auto [success, latency] = result.get();
+		worst = std::max(worst, latency);
+		failed += success ? 0 : 1;
+	}
+
+	if (failed > 0) {
+		LOG_ERROR("STOP: Failed to send to {} of {} drives, worst case {:.3f} ms", failed, results.size(), worst * 1000.0);
+	}
+	else {
+		LOG_WARN("STOP: All axes of {} drives set to idle, worst case {:.3f} ms", results.size(), worst * 1000.0);
+	}
 }
 
 void Backend::odriveDisconnected(int odriveID) {
@@ -204,14 +348,16 @@ void Backend::odriveDisconnected(int odriveID) {
 
 void Backend::updateEndpointCache(int odriveID) {
 
-	if (!odrives[odriveID])
+	auto odrive = odrives.get(odriveID);
+	if (!odrive)
 		return;
 
 	// Loop through every endpoint of the odrive
+	TransferPriorityScope priority(TransferPriority::BACKGROUND);
 	cachedEndpointValues.clear();
-	for (BasicEndpoint& ep : odrives[odriveID]->cachedEndpoints) {
+	for (BasicEndpoint& ep : odrive->cachedEndpoints) {
 		if (ep.type != "function") {	// It's a numeric type, objects are not in the cached list	
-			EndpointValue& value = readEndpointDirect(ep);
+			EndpointValue value = readEndpointDirect(ep);
 			if (value.type() != EndpointValueType::INVALID) {
 				cachedEndpointValues.emplace(ep.fullPath, value);
 			}
@@ -229,30 +375,23 @@ EndpointValue Backend::getCachedEndpointValue(const std::string& fullPath) {
 	return EndpointValue(EndpointValueType::INVALID);
 }
 
-#define READ_ENDPOINT(_type, T)	if (ep.type == _type)	{ T temp = 0; if (readEndpointDirectRaw<T>(ep, &temp)) return EndpointValue(temp); }
+EndpointValue Backend::readEndpointDirect(const BasicEndpoint& ep, SampleTime* time) {
 
-EndpointValue Backend::readEndpointDirect(const BasicEndpoint& ep) {
+	auto odrive = odrives.get(ep.odriveID);
+	if (!odrive)
+		return EndpointValue(EndpointValueType::INVALID);
 
-	READ_ENDPOINT("bool", bool);
-	READ_ENDPOINT("float", float);
-	READ_ENDPOINT("uint8", uint8_t);
-	READ_ENDPOINT("uint16", uint16_t);
-	READ_ENDPOINT("uint32", uint32_t);
-	READ_ENDPOINT("uint64", uint64_t);
-	READ_ENDPOINT("int32", int32_t);
-
-	return EndpointValue(EndpointValueType::INVALID);
+	return odrive->readValue(ep, time);
 }
 
 void Backend::writeEndpointDirect(const BasicEndpoint& ep, const EndpointValue& value) {
-	switch (value.type()) {
-	case EndpointValueType::BOOL:	writeEndpointDirectRaw(ep, value.get<bool>()); break;
-	case EndpointValueType::FLOAT:	writeEndpointDirectRaw(ep, value.get<float>()); break;
-	case EndpointValueType::UINT8:	writeEndpointDirectRaw(ep, value.get<uint8_t>()); break;
-	case EndpointValueType::UINT16:	writeEndpointDirectRaw(ep, value.get<uint16_t>()); break;
-	case EndpointValueType::UINT32:	writeEndpointDirectRaw(ep, value.get<uint32_t>()); break;
-	case EndpointValueType::UINT64:	writeEndpointDirectRaw(ep, value.get<uint64_t>()); break;
-	case EndpointValueType::INT32:	writeEndpointDirectRaw(ep, value.get<int32_t>()); break;
+
+	auto odrive = odrives.get(ep.odriveID);
+	if (!odrive)
+		return;
+
+	if (odrive->postValue(ep, value)) {		// Repeated writes to the same endpoint are coalesced
+		LOG_DEBUG("Writing {} to endpoint {}", value.toString(), ep.fullPath);
 	}
 }
 
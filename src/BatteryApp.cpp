@@ -3,6 +3,7 @@
 #include "BatteryApp.h"
 #include "Battery/AllegroDeps.h"
 #include "Backend.h"
+#include "Benchmark.h"
 
 #define UPDATE_CACHE_FREQUENCY 5.f
 
@@ -13,6 +14,8 @@ BatteryApp::BatteryApp() : Battery::Application(1280, 720, "ODriveGui") {
 
 bool BatteryApp::OnStartup() {
 
+	int emulatedDevices = 0;
+	int benchmarkDevices = 0;
 	for (size_t i = 1; i < args.size(); i++) {
 		if (args[i] == "--verbose") {
 			LOG_SET_LOGLEVEL(BATTERY_LOG_LEVEL_DEBUG);
@@ -24,16 +27,31 @@ bool BatteryApp::OnStartup() {
 			libusbcpp::setLogLevel(libusbcpp::LOG_LEVEL_TRACE);
 			LOG_INFO("Trace logging enabled, set log level to LOG_LEVEL_TRACE");
 		}
+		else if (args[i] == "--emulate" && i + 1 < args.size()) {
+			emulatedDevices = std::max(std::atoi(args[++i].c_str()), 0);
+		}
+		else if (args[i] == "--benchmark" && i + 1 < args.size()) {
+			benchmarkDevices = std::max(std::atoi(args[++i].c_str()), 0);
+		}
 		else {
 			LOG_ERROR("[{}]: Unknown parameter! Available:", args[i]);
-			LOG_ERROR("                                       --verbose  -> Debug logging");
-			LOG_ERROR("                                       --trace    -> All the logging");
+			LOG_ERROR("                                       --verbose      -> Debug logging");
+			LOG_ERROR("                                       --trace        -> All the logging");
+			LOG_ERROR("                                       --emulate N    -> Connect N emulated ODrives");
+			LOG_ERROR("                                       --benchmark N  -> Poll up to N emulated ODrives and log the timing");
 			CloseApplication();
 		}
 	}
 
+	if (benchmarkDevices > 0) {
+		RunScalingBenchmark(benchmarkDevices);
+		CloseApplication();
+		return true;
+	}
+
 	window.SetTitle("ODriveGui");
 	backend = std::make_unique<Backend>();
+	backend->connectEmulatedDevices(emulatedDevices);
 
 	ui = std::make_shared<UserInterface>();
 	PushOverlay(ui);
@@ -49,13 +67,15 @@ bool BatteryApp::OnStartup() {
 }
 
 void BatteryApp::OnUpdate() {
+	if (!backend)		// Only the benchmark ran
+		return;
+
 	backend->handleNewDevices();
 	// Request all errors as a health check of the connection
 	if (framecount % 30 == 1) {
-		for (int i = 0; i < MAX_NUMBER_OF_ODRIVES; i++) {
-			if (backend->odrives[i]) {
-				backend->odrives[i]->updateErrors();
-			}
+		TransferPriorityScope priority(TransferPriority::POLL);
+		for (auto& odrive : backend->odrives.list()) {
+			odrive->updateErrors();
 		}
 	}
 }
@@ -67,7 +87,9 @@ void BatteryApp::OnRender() {
 void BatteryApp::OnShutdown() {
 	shouldClose = true;
 	window.Hide();
-	backendUpdateThread.join();
+	if (backendUpdateThread.joinable()) {
+		backendUpdateThread.join();
+	}
 	backend.reset();
 }
 
@@ -79,6 +101,9 @@ void BatteryApp::OnEvent(Battery::Event* e) {
 		if (static_cast<Battery::KeyPressedEvent*>(e)->keycode == ALLEGRO_KEY_SPACE) {
 			// Space pressed
 		}
+		else if (static_cast<Battery::KeyPressedEvent*>(e)->keycode == ALLEGRO_KEY_ESCAPE && backend) {
+			backend->stopAll();
+		}
 	}
 }
 
@@ -0,0 +1,86 @@
+
+#include "pch.h"
+#include "Benchmark.h"
+#include "DeviceRegistry.h"
+#include "EmulatedODrive.h"
+#include "ThreadPool.h"
+#include "Backend.h"
+
+static const std::vector<std::string> benchmarkChannels = {
+	"vbus_voltage",
+	"axis0.encoder.pos_estimate",
+	"axis0.encoder.vel_estimate",
+	"axis0.motor.current_control.Iq_measured",
+	"axis0.controller.input_pos",
+	"axis1.encoder.pos_estimate",
+};
+
+static void benchmarkDevices(int count) {
+
+	DeviceRegistry registry;
+	for (int i = 0; i < count; i++) {
+		auto odrive = std::make_shared<ODrive>(std::make_shared<EmulatedTransport>(EMULATED_SERIAL_NUMBER_BASE + i));
+		odrive->getSerialNumber();
+		registry.add(odrive);
+	}
+
+	// Poll every channel of every device, like Backend::updateEntryCache does
+	size_t reads = 0;
+	size_t failed = 0;
+	double start = Battery::GetRuntime();
+	for (int pass = 0; pass < BENCHMARK_POLL_PASSES; pass++) {
+		for (auto& odrive : registry.list()) {
+			for (const std::string& channel : benchmarkChannels) {
+				float value = 0.f;
+				if (!odrive->read<float>(channel, &value)) {
+					failed++;
+				}
+				reads++;
+			}
+		}
+	}
+	double pollTime = (Battery::GetRuntime() - start) / BENCHMARK_POLL_PASSES;
+
+	// The same, but with one task per device on a thread pool like the backend does it
+	ThreadPool pool("benchmark", std::min(count, IO_POOL_THREADS));
+	start = Battery::GetRuntime();
+	for (int pass = 0; pass < BENCHMARK_POLL_PASSES; pass++) {
+		std::vector<std::future<void>> results;
+		for (auto& odrive : registry.list()) {
+			results.push_back(pool.async([odrive] {
+				for (const std::string& channel : benchmarkChannels) {
+					float value = 0.f;
+					odrive->read<float>(channel, &value);
+				}
+			}));
+		}
+		for (auto& result : results) {
+			result.wait();
+		}
+	}
+	double parallelPollTime = (Battery::GetRuntime() - start) / BENCHMARK_POLL_PASSES;
+
+	// Cost of looking devices up by ID, which every endpoint access does
+	const int lookups = 1000000;
+	size_t found = 0;
+	start = Battery::GetRuntime();
+	for (int i = 0; i < lookups; i++) {
+		if (registry.get(i % count)) {
+			found++;
+		}
+	}
+	double lookupTime = (Battery::GetRuntime() - start) / lookups;
+
+	LOG_INFO("{:>4} devices: {:8.2f} ms per serial poll pass, {:8.2f} ms per parallel poll pass, {:6.1f} us per read, {:6.1f} ns per lookup, {} failed reads",
+		count, pollTime * 1e3, parallelPollTime * 1e3, pollTime / (reads / BENCHMARK_POLL_PASSES) * 1e6, lookupTime * 1e9, failed);
+}
+
+void RunScalingBenchmark(int maxDevices) {
+	LOG_INFO("Running scaling benchmark with up to {} emulated devices ({} channels each, {:.1f} ms simulated latency)",
+		maxDevices, benchmarkChannels.size(), EMULATED_USB_LATENCY * 1e3);
+
+	for (int count = 1; count < maxDevices; count *= 2) {
+		benchmarkDevices(count);
+	}
+	benchmarkDevices(maxDevices);
+}
@@ -0,0 +1,66 @@
+
+#include "pch.h"
+#include "ChangeBus.h"
+
+std::shared_ptr<ChangeBus::Subscriber> ChangeBus::subscribe(size_t capacity) {
+	std::lock_guard<std::mutex> lock(publisherMutex);
+	auto subscriber = std::make_shared<Subscriber>(capacity);
+	subscribers.push_back(subscriber);
+
+	// Give the new subscriber the current state of everything we know, as it was read
+	for (auto& [handle, change] : lastValues) {
+		subscriber->queue.push(change);
+	}
+
+	return subscriber;
+}
+
+void ChangeBus::unsubscribe(const std::shared_ptr<Subscriber>& subscriber) {
+	std::lock_guard<std::mutex> lock(publisherMutex);
+	subscribers.erase(std::remove(subscribers.begin(), subscribers.end(), subscriber), subscribers.end());
+}
+
+size_t ChangeBus::publish(const std::vector<ValueChange>& samples) {
+	std::lock_guard<std::mutex> lock(publisherMutex);
+
+	changes.clear();
+	for (const ValueChange& sample : samples) {
+		if (sample.value.type() == EndpointValueType::INVALID)
+			continue;
+
+		auto it = lastValues.find(sample.handle);
+		if (it == lastValues.end()) {
+			lastValues.emplace(sample.handle, sample);
+			changes.push_back(sample);
+		}
+		else if (it->second.value != sample.value) {
+			it->second = sample;
+			changes.push_back(sample);
+		}
+	}
+
+	if (changes.empty())	// Nothing happened, nothing to do
+		return 0;
+
+	for (auto& subscriber : subscribers) {
+		for (const ValueChange& change : changes) {
+			if (!subscriber->queue.push(change)) {
+				subscriber->dropped++;		// Subscriber is not keeping up
+			}
+		}
+	}
+
+	return changes.size();
+}
+
+void ChangeBus::resetDevice(int odriveID) {
+	std::lock_guard<std::mutex> lock(publisherMutex);
+	for (auto it = lastValues.begin(); it != lastValues.end();) {
+		if ((int)(it->first >> 16) == odriveID) {
+			it = lastValues.erase(it);
+		}
+		else {
+			it++;
+		}
+	}
+}
@@ -0,0 +1,67 @@
+
+#include "pch.h"
+#include "ChannelCapture.h"
+
+ChannelCapture::ChannelCapture(std::shared_ptr<ODrive> odrive, const std::vector<std::string>& identifiers) : odrive(odrive), identifiers(identifiers) {
+
+	if (!odrive)
+		return;
+
+	for (auto& identifier : identifiers) {
+		auto endpoint = odrive->findEndpoint(identifier);
+		if (!endpoint || EndpointValue(endpoint->type).type() == EndpointValueType::INVALID) {
+			LOG_ERROR("odrv{}: {} can't be captured, it is not a value", odrive->odriveID, identifier);
+			batch.clear();
+			return;
+		}
+		batch.addRead(*endpoint);
+	}
+}
+
+bool ChannelCapture::run(double duration, double rate, CaptureColumns& columns, const std::atomic<bool>* abort) {
+
+	if (!valid())
+		return false;
+
+	columns.values.resize(identifiers.size());
+	size_t expected = columns.size() + (size_t)(duration * (rate > 0 ? rate : 2000.0));
+	columns.timestamps.reserve(expected);
+	columns.sent.reserve(expected);
+	columns.received.reserve(expected);
+	for (auto& column : columns.values) {
+		column.reserve(expected);
+	}
+
+	using clock = std::chrono::steady_clock;
+	auto period = std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(rate > 0 ? 1.0 / rate : 0.0));
+	auto nextSample = clock::now();
+	double end = Battery::GetRuntime() + duration;
+
+	while (Battery::GetRuntime() < end && !(abort && *abort)) {
+
+		if (rate > 0) {		// Absolute schedule, same as the StreamSampler
+			nextSample += period;
+			auto now = clock::now();
+			if (nextSample < now - period) {
+				nextSample = now;
+			}
+			std::this_thread::sleep_until(nextSample);
+		}
+
+		if (!odrive->transact(batch)) {
+			failed++;
+			if (!odrive->connected)
+				return false;
+			continue;
+		}
+
+		SampleTime time = batch.sampleTime();
+		columns.timestamps.push_back(time.sampled);
+		columns.sent.push_back(time.sent);
+		columns.received.push_back(time.received);
+		for (size_t i = 0; i < batch.results.size(); i++) {
+			columns.values[i].push_back(batch.results[i].toDouble());
+		}
+	}
+	return true;
+}
@@ -0,0 +1,88 @@
+
+#include "pch.h"
+#include "ConfigDiff.h"
+
+#include <future>
+
+std::vector<ConfigDiff::Column> ConfigDiff::CaptureDevices(const DeviceRegistry& registry, const std::vector<int>& odriveIDs, ThreadPool& pool) {
+
+	std::vector<std::future<std::optional<ConfigSnapshot>>> captures;
+	for (int id : odriveIDs) {
+		captures.push_back(pool.async([odrive = registry.get(id)]() -> std::optional<ConfigSnapshot> {
+			if (!odrive)
+				return std::nullopt;
+			TransferPriorityScope priority(TransferPriority::INTERACTIVE);
+			return ConfigSnapshot::Capture(*odrive);
+		}));
+	}
+
+	std::vector<Column> columns;
+	for (size_t i = 0; i < captures.size(); i++) {
+		auto snapshot = captures[i].get();
+		if (snapshot) {
+			columns.push_back({ "odrv" + std::to_string(odriveIDs[i]), std::move(*snapshot) });
+		}
+	}
+	return columns;
+}
+
+ConfigDiff ConfigDiff::Compare(const std::vector<Column>& columns, const DeviceRegistry& registry) {
+
+	double start = Battery::GetRuntime();
+	ConfigDiff diff;
+
+	// Endpoint id -> identifier, once per firmware
+	std::unordered_map<uint16_t, std::unordered_map<uint16_t, const std::string*>> identifiers;
+	auto devices = registry.list();
+	for (auto& column : columns) {
+		uint16_t crc = column.snapshot.jsonCRC;
+		if (identifiers.count(crc))
+			continue;
+
+		auto device = std::find_if(devices.begin(), devices.end(), [crc](auto& d) { return d->jsonCRC == crc && d->loaded; });
+		if (device == devices.end()) {
+			LOG_WARN("{} can't be compared: No connected device has JSON CRC 0x{:04X}", column.label, crc);
+			continue;
+		}
+
+		auto& names = identifiers[crc];
+		for (const BasicEndpoint& endpoint : (*device)->cachedEndpoints) {
+			names.emplace(endpoint.id, &endpoint.identifier);
+		}
+	}
+
+	// Every identifier gets one row with a slot per column
+	std::unordered_map<std::string, size_t> rowIndex;
+	std::vector<Row> all;
+	for (size_t c = 0; c < columns.size(); c++) {
+		auto names = identifiers.find(columns[c].snapshot.jsonCRC);
+		if (names == identifiers.end())
+			continue;
+
+		for (auto& [id, value] : columns[c].snapshot.values) {
+			auto name = names->second.find(id);
+			if (name == names->second.end())
+				continue;
+
+			auto [it, inserted] = rowIndex.emplace(*name->second, all.size());
+			if (inserted) {
+				all.push_back({ *name->second, std::vector<EndpointValue>(columns.size()) });
+			}
+			all[it->second].values[c] = value;
+		}
+	}
+
+	for (auto& column : columns) {
+		diff.labels.push_back(column.label);
+	}
+	diff.compared = all.size();
+	for (auto& row : all) {
+		if (std::any_of(row.values.begin(), row.values.end(), [&](auto& v) { return v != row.values[0]; })) {
+			diff.rows.push_back(std::move(row));
+		}
+	}
+	std::sort(diff.rows.begin(), diff.rows.end(), [](auto& a, auto& b) { return a.identifier < b.identifier; });
+
+	diff.duration = Battery::GetRuntime() - start;
+	return diff;
+}
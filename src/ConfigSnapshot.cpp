@@ -0,0 +1,186 @@
+
+#include "pch.h"
+#include "ConfigSnapshot.h"
+
+#include <fstream>
+
+template<typename T>
+static void append(buffer_t& buffer, T value) {
+	uint8_t bytes[sizeof(T)];
+	memcpy(bytes, &value, sizeof(T));
+	buffer.insert(buffer.end(), bytes, bytes + sizeof(T));
+}
+
+template<typename T>
+static bool extract(const buffer_t& buffer, size_t& offset, T& value) {
+	if (offset + sizeof(T) > buffer.size())
+		return false;
+	memcpy(&value, &buffer[offset], sizeof(T));
+	offset += sizeof(T);
+	return true;
+}
+
+bool ConfigSnapshot::IsConfiguration(const BasicEndpoint& endpoint) {
+	if (endpoint.readonly || EndpointValue(endpoint.type).type() == EndpointValueType::INVALID)
+		return false;
+
+	return endpoint.identifier.rfind("config.", 0) == 0 || endpoint.identifier.find(".config.") != std::string::npos;
+}
+
+std::optional<ConfigSnapshot> ConfigSnapshot::Capture(ODrive& odrive) {
+
+	if (!odrive)
+		return std::nullopt;
+
+	ConfigSnapshot snapshot;
+	snapshot.serialNumber = odrive.serialNumber;
+	snapshot.jsonCRC = odrive.jsonCRC;
+	snapshot.created = (int64_t)std::time(nullptr);
+
+	RequestBatch batch;
+	std::vector<uint16_t> ids;
+	for (const BasicEndpoint& endpoint : odrive.cachedEndpoints) {
+		if (IsConfiguration(endpoint)) {
+			batch.addRead(endpoint);
+			ids.push_back(endpoint.id);
+		}
+	}
+
+	if (!odrive.transact(batch)) {
+		LOG_ERROR("Backup of odrv{} failed: Not all parameters could be read", odrive.odriveID);
+		return std::nullopt;
+	}
+
+	for (size_t i = 0; i < ids.size(); i++) {
+		snapshot.values.emplace_back(ids[i], batch.results[i]);
+	}
+	std::sort(snapshot.values.begin(), snapshot.values.end(), [](auto& a, auto& b) { return a.first < b.first; });
+	return snapshot;
+}
+
+ConfigSnapshot::RestoreResult ConfigSnapshot::restore(ODrive& odrive, bool save) const {
+
+	double start = Battery::GetRuntime();
+	RestoreResult result;
+	result.total = values.size();
+
+	if (odrive.jsonCRC != jsonCRC) {
+		LOG_ERROR("Cannot restore to odrv{}: The snapshot was taken with a different firmware (JSON CRC 0x{:04X} instead of 0x{:04X})", odrive.odriveID, jsonCRC, odrive.jsonCRC);
+		return result;
+	}
+
+	// The live configuration in one batch, so only the difference has to be written
+	std::optional<ConfigSnapshot> live = Capture(odrive);
+	if (!live)
+		return result;
+
+	ConfigTransaction transaction;
+	for (auto& [id, value] : values) {
+		if (live->find(id) == value)
+			continue;
+
+		auto it = std::find_if(odrive.cachedEndpoints.begin(), odrive.cachedEndpoints.end(), [id = id](const BasicEndpoint& e) { return e.id == id; });
+		if (it != odrive.cachedEndpoints.end()) {
+			transaction.set(it->identifier, value);
+		}
+	}
+	transaction.save(save);
+	result.differing = transaction.size();
+
+	if (!transaction.empty()) {
+		result.transaction = transaction.commit(odrive);
+		result.success = result.transaction.success;
+	}
+	else {
+		result.success = true;
+	}
+
+	result.duration = Battery::GetRuntime() - start;
+	LOG_INFO("Restored odrv{}: {} of {} parameters differed, {:.1f} ms", odrive.odriveID, result.differing, result.total, result.duration * 1000.0);
+	return result;
+}
+
+EndpointValue ConfigSnapshot::find(uint16_t id) const {
+	auto it = std::lower_bound(values.begin(), values.end(), id, [](auto& entry, uint16_t id) { return entry.first < id; });
+	if (it == values.end() || it->first != id)
+		return EndpointValue(EndpointValueType::INVALID);
+	return it->second;
+}
+
+buffer_t ConfigSnapshot::serialize() const {
+	buffer_t data;
+	data.reserve(28 + values.size() * 11);
+	append<uint32_t>(data, CONFIG_SNAPSHOT_MAGIC);
+	append<uint16_t>(data, CONFIG_SNAPSHOT_VERSION);
+	append<uint64_t>(data, serialNumber);
+	append<uint16_t>(data, jsonCRC);
+	append<int64_t>(data, created);
+	append<uint32_t>(data, (uint32_t)values.size());
+
+	for (auto& [id, value] : values) {
+		uint64_t raw = 0;
+		value.toBytes((uint8_t*)&raw);
+		append<uint16_t>(data, id);
+		append<uint8_t>(data, (uint8_t)value.type());
+		append<uint64_t>(data, raw);
+	}
+	return data;
+}
+
+std::optional<ConfigSnapshot> ConfigSnapshot::Deserialize(const buffer_t& data) {
+	ConfigSnapshot snapshot;
+	size_t offset = 0;
+	uint32_t magic = 0;
+	uint16_t version = 0;
+	uint32_t count = 0;
+
+	if (!extract(data, offset, magic) || magic != CONFIG_SNAPSHOT_MAGIC)
+		return std::nullopt;
+	if (!extract(data, offset, version) || version != CONFIG_SNAPSHOT_VERSION)
+		return std::nullopt;
+	if (!extract(data, offset, snapshot.serialNumber) || !extract(data, offset, snapshot.jsonCRC) ||
+		!extract(data, offset, snapshot.created) || !extract(data, offset, count))
+		return std::nullopt;
+
+	for (uint32_t i = 0; i < count; i++) {
+		uint16_t id = 0;
+		uint8_t type = 0;
+		uint64_t raw = 0;
+		if (!extract(data, offset, id) || !extract(data, offset, type) || !extract(data, offset, raw))
+			return std::nullopt;
+
+		EndpointValue value((EndpointValueType)type);
+		if (!value.fromBytes((uint8_t*)&raw, value.size()))
+			return std::nullopt;
+		snapshot.values.emplace_back(id, value);
+	}
+	return snapshot;
+}
+
+bool ConfigSnapshot::save(const std::string& path) const {
+	std::ofstream file(path, std::ios::binary);
+	if (!file.is_open()) {
+		LOG_ERROR("Cannot write configuration snapshot {}", path);
+		return false;
+	}
+	buffer_t data = serialize();
+	file.write((const char*)data.data(), data.size());
+	return file.good();
+}
+
+std::optional<ConfigSnapshot> ConfigSnapshot::Load(const std::string& path) {
+	std::ifstream file(path, std::ios::binary);
+	if (!file.is_open())
+		return std::nullopt;
+
+	buffer_t data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+	auto snapshot = Deserialize(data);
+	if (!snapshot) {
+		LOG_ERROR("{} is not a valid configuration snapshot", path);
+	}
+	return snapshot;
+}
+
+std::string ConfigSnapshot::DefaultPath(uint64_t serialNumber, uint16_t jsonCRC) {
+	return fmt::format("{}config_{:012X}_{:04X}.odcs", Battery::GetExecutableDirectory(), serialNumber, jsonCRC);
+}
@@ -0,0 +1,116 @@
+
+#include "pch.h"
+#include "ConfigTransaction.h"
+
+const char* ConfigTransaction::StatusName(ItemStatus status) {
+	switch (status) {
+	case ItemStatus::OK:				return "OK";
+	case ItemStatus::NOT_SENT:			return "Not sent";
+	case ItemStatus::UNKNOWN_ENDPOINT:	return "Unknown endpoint";
+	case ItemStatus::NOT_WRITABLE:		return "Not writable";
+	case ItemStatus::INVALID_VALUE:		return "Invalid value";
+	case ItemStatus::MISMATCH:			return "Mismatch";
+	case ItemStatus::NO_READ_BACK:		return "No read-back";
+	}
+	return "Unknown";
+}
+
+ConfigTransaction::ItemStatus ConfigTransaction::validate(const BasicEndpoint* endpoint, const EndpointValue& value, EndpointValue& converted) {
+
+	if (!endpoint)
+		return ItemStatus::UNKNOWN_ENDPOINT;
+
+	converted = EndpointValue(endpoint->type);
+	if (converted.type() == EndpointValueType::INVALID || endpoint->readonly)
+		return ItemStatus::NOT_WRITABLE;
+
+	if (value.type() == EndpointValueType::INVALID)
+		return ItemStatus::INVALID_VALUE;
+
+	converted = value.as(endpoint->type);
+
+	// The conversion must not change the number, e.g. 1.5 into an integer or -1 into an unsigned
+	double number = value.toDouble();
+	if (converted.type() == EndpointValueType::FLOAT || converted.type() == value.type()) {
+		return ItemStatus::OK;
+	}
+	else if (converted.type() == EndpointValueType::BOOL) {
+		if (number != 0.0 && number != 1.0)
+			return ItemStatus::INVALID_VALUE;
+	}
+	else if (converted.toDouble() != number) {
+		return ItemStatus::INVALID_VALUE;
+	}
+
+	return ItemStatus::OK;
+}
+
+ConfigTransaction::Result ConfigTransaction::commit(ODrive& odrive) const {
+
+	double start = Battery::GetRuntime();
+	Result result;
+	result.items.resize(items.size());
+
+	// Validate everything before anything is sent
+	bool valid = true;
+	std::vector<const BasicEndpoint*> endpoints(items.size());
+	for (size_t i = 0; i < items.size(); i++) {
+		endpoints[i] = odrive.findEndpoint(items[i].identifier);
+		result.items[i].identifier = items[i].identifier;
+
+		ItemStatus status = validate(endpoints[i], items[i].value, result.items[i].written);
+		if (status != ItemStatus::OK) {
+			result.items[i].status = status;
+			valid = false;
+		}
+	}
+
+	if (!valid) {
+		LOG_ERROR("Configuration of odrv{} was not sent, {} items are invalid", odrive.odriveID,
+			std::count_if(result.items.begin(), result.items.end(), [](const ItemResult& item) { return item.status != ItemStatus::NOT_SENT; }));
+		result.duration = Battery::GetRuntime() - start;
+		return result;
+	}
+
+	// The writes don't wait for any response, so they leave back to back. Then everything is read back.
+	RequestBatch batch;
+	for (size_t i = 0; i < items.size(); i++) {
+		batch.addWrite(*endpoints[i], result.items[i].written);
+	}
+	size_t firstRead = batch.size();
+	for (size_t i = 0; i < items.size(); i++) {
+		batch.addRead(*endpoints[i]);
+	}
+	odrive.transact(batch);
+
+	result.success = true;
+	for (size_t i = 0; i < items.size(); i++) {
+		ItemResult& item = result.items[i];
+		item.readBack = batch.results[firstRead + i];
+		if (item.readBack.type() == EndpointValueType::INVALID) {
+			item.status = ItemStatus::NO_READ_BACK;
+		}
+		else if (item.readBack != item.written) {
+			item.status = ItemStatus::MISMATCH;
+		}
+		else {
+			item.status = ItemStatus::OK;
+		}
+		result.success &= item.status == ItemStatus::OK;
+	}
+
+	// Only a verified configuration is made permanent
+	if (saveConfiguration && result.success) {
+		result.saved = odrive.saveConfiguration();
+		result.success = result.saved;
+	}
+
+	result.duration = Battery::GetRuntime() - start;
+	if (result.success) {
+		LOG_INFO("Configured {} parameters of odrv{} in {:.1f} ms{}", items.size(), odrive.odriveID, result.duration * 1000.0, result.saved ? " and saved" : "");
+	}
+	else {
+		LOG_WARN("Configuration of odrv{} incomplete after {:.1f} ms", odrive.odriveID, result.duration * 1000.0);
+	}
+	return result;
+}
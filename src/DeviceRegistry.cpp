@@ -0,0 +1,57 @@
+
+#include "pch.h"
+#include "DeviceRegistry.h"
+
+int DeviceRegistry::add(std::shared_ptr<ODrive> odrv) {
+
+	if (!odrv)
+		return -1;
+
+	int id = -1;
+	state.update([&](Snapshot& next) {
+		auto it = next.idsBySerial.find(odrv->serialNumber);
+		if (it != next.idsBySerial.end()) {		// Known device reconnected, it gets its old ID back
+			id = it->second;
+			odrv->setODriveID(id);
+			next.devices[id] = odrv;
+			return;
+		}
+
+		if (next.devices.size() > 0xFFFF) {		// The ID must fit into the upper half of an EndpointHandle
+			LOG_ERROR("Device can't be connected: Too many devices!");
+			return;
+		}
+
+		id = (int)next.devices.size();
+		odrv->setODriveID(id);
+		next.devices.push_back(odrv);
+		next.idsBySerial.emplace(odrv->serialNumber, id);
+	});
+
+	return id;
+}
+
+std::shared_ptr<ODrive> DeviceRegistry::get(int odriveID) const {
+	auto snapshot = state.read();
+	if (odriveID < 0 || odriveID >= (int)snapshot->devices.size())
+		return nullptr;
+
+	return snapshot->devices[odriveID];
+}
+
+std::shared_ptr<ODrive> DeviceRegistry::getBySerial(uint64_t serialNumber) const {
+	auto snapshot = state.read();
+	auto it = snapshot->idsBySerial.find(serialNumber);
+	if (it == snapshot->idsBySerial.end())
+		return nullptr;
+
+	return snapshot->devices[it->second];
+}
+
+std::vector<std::shared_ptr<ODrive>> DeviceRegistry::list() const {
+	return state.read()->devices;
+}
+
+size_t DeviceRegistry::size() const {
+	return state.read()->devices.size();
+}
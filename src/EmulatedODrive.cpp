@@ -0,0 +1,451 @@
+
+#include "pch.h"
+#include "EmulatedODrive.h"
+
+#define EMULATED_INERTIA 0.001					// Rotor inertia in Nm/(turn/s^2)
+#define EMULATED_TORQUE_CONSTANT 0.04			// Nm/A
+#define EMULATED_SIMULATION_STEP 0.0005			// Integration step of the motor model in seconds
+#define EMULATED_SCOPE_SIZE 4096				// Values in the oscilloscope buffer, all channels together
+#define EMULATED_SCOPE_CHANNELS 4
+
+static size_t typeSize(const std::string& type) {
+	if (type == "bool" || type == "uint8") return 1;
+	if (type == "uint16") return 2;
+	if (type == "uint32" || type == "int32" || type == "float") return 4;
+	if (type == "uint64") return 8;
+	return 0;
+}
+
+static uint64_t floatBits(float value) {
+	uint32_t bits = 0;
+	memcpy(&bits, &value, sizeof(bits));
+	return bits;
+}
+
+EmulatedTransport::EmulatedTransport(uint64_t serialNumber, double latency) : latency(latency), serialNumber(serialNumber) {
+
+	properties.push_back({ "json" });	// Endpoint 0 is always the JSON definition
+	nlohmann::json root = nlohmann::json::array();
+	root.push_back({ { "name", "" }, { "id", 0 }, { "type", "json" }, { "access", "r" } });
+
+	addProperty(root, "", "vbus_voltage", "float", true, floatBits(24.f));
+	addProperty(root, "", "ibus", "float", true, floatBits(0.f));
+	addProperty(root, "", "serial_number", "uint64", true, serialNumber);
+	addProperty(root, "", "hw_version_major", "uint8", true, 3);
+	addProperty(root, "", "hw_version_minor", "uint8", true, 6);
+	addProperty(root, "", "fw_version_major", "uint8", true, 0);
+	addProperty(root, "", "fw_version_minor", "uint8", true, 5);
+	root.push_back(makeAxis(0));
+	root.push_back(makeAxis(1));
+	root.push_back(makeOscilloscope());
+	addFunction(root, "", "get_adc_voltage", [this] {
+		setFloat("get_adc_voltage.value", 3.3f * (float)(getInt("get_adc_voltage.gpio") % 16) / 16.f);
+	}, { { "gpio", "uint32" } }, { { "value", "float" } });
+	addFunction(root, "", "save_configuration", [this] {		// Refused while an axis is not idle, like the firmware
+		setInt("save_configuration.result", getInt("axis0.current_state") == 1 && getInt("axis1.current_state") == 1);
+	}, {}, { { "result", "bool" } });
+	addFunction(root, "", "reboot", [this] {		// Never acknowledged, the device is gone before
+		detached = true;
+		rebootEnd = Battery::GetRuntime() + EMULATED_REBOOT_TIME;
+		responses.clear();
+	});
+	addFunction(root, "", "clear_errors", [this] {
+		for (int axis = 0; axis < 2; axis++) {
+			properties[ids["axis" + std::to_string(axis) + ".clear_errors"]].function();
+		}
+	});
+
+	json = root.dump();
+	lastSimulation = Battery::GetRuntime();
+}
+
+uint16_t EmulatedTransport::addProperty(nlohmann::json& members, const std::string& path, const std::string& name, const std::string& type, bool readonly, uint64_t value) {
+	uint16_t id = (uint16_t)properties.size();
+	properties.push_back({ type, value });
+	ids[path + name] = id;
+	members.push_back({ { "name", name }, { "id", id }, { "type", type }, { "access", readonly ? "r" : "rw" } });
+	return id;
+}
+
+uint16_t EmulatedTransport::addFunction(nlohmann::json& members, const std::string& path, const std::string& name, std::function<void()> function,
+	const Arguments& inputs, const Arguments& outputs) {
+
+	uint16_t id = (uint16_t)properties.size();
+	properties.push_back({ "function", 0, function });
+	ids[path + name] = id;
+
+	// Arguments are properties of their own, the function reads and writes them
+	nlohmann::json inputsJson = nlohmann::json::array();
+	for (auto& [argument, type] : inputs) {
+		addProperty(inputsJson, path + name + ".", argument, type, false);
+	}
+	nlohmann::json outputsJson = nlohmann::json::array();
+	for (auto& [argument, type] : outputs) {
+		addProperty(outputsJson, path + name + ".", argument, type, true);
+	}
+
+	members.push_back({ { "name", name }, { "id", id }, { "type", "function" }, { "inputs", inputsJson }, { "outputs", outputsJson } });
+	return id;
+}
+
+// The scope records up to four sources per control loop cycle, interleaved into one buffer. A source
+// is the endpoint id of any numeric property, by default pos_estimate, vel_estimate, Iq_measured and
+// input_pos of axis0.
+nlohmann::json EmulatedTransport::makeOscilloscope() {
+	std::string path = "oscilloscope.";
+	nlohmann::json members = nlohmann::json::array();
+	addProperty(members, path, "size", "uint32", true, EMULATED_SCOPE_SIZE);
+	addProperty(members, path, "pos", "uint32", true);
+	addProperty(members, path, "sample_rate", "float", true, floatBits(1.f / (float)EMULATED_SIMULATION_STEP));
+
+	nlohmann::json config = nlohmann::json::array();
+	addProperty(config, path + "config.", "channels", "uint8", false, 1);
+	addProperty(config, path + "config.", "decimation", "uint32", false, 1);
+	const char* sources[EMULATED_SCOPE_CHANNELS] = { "axis0.encoder.pos_estimate", "axis0.encoder.vel_estimate",
+		"axis0.motor.current_control.Iq_measured", "axis0.controller.input_pos" };
+	for (int c = 0; c < EMULATED_SCOPE_CHANNELS; c++) {
+		addProperty(config, path + "config.", "source" + std::to_string(c), "uint16", false, ids[sources[c]]);
+	}
+	members.push_back({ { "name", "config" }, { "type", "object" }, { "members", config } });
+
+	addFunction(members, path, "trigger", [this] {
+		scope.buffer.clear();
+		scope.cycle = 0;
+		scope.capturing = true;
+		setInt("oscilloscope.pos", 0);
+	});
+	addFunction(members, path, "get_val", [this] {
+		uint64_t index = getInt("oscilloscope.get_val.index");
+		setFloat("oscilloscope.get_val.val", index < scope.buffer.size() ? scope.buffer[index] : NAN);
+	}, { { "index", "uint32" } }, { { "val", "float" } });
+
+	return { { "name", "oscilloscope" }, { "type", "object" }, { "members", members } };
+}
+
+nlohmann::json EmulatedTransport::makeAxis(int axis) {
+	std::string path = "axis" + std::to_string(axis) + ".";
+	nlohmann::json members = nlohmann::json::array();
+
+	addProperty(members, path, "error", "uint32", false);
+	addProperty(members, path, "current_state", "uint8", true, 1);
+	addProperty(members, path, "requested_state", "uint8", false);
+
+	nlohmann::json config = nlohmann::json::array();
+	addProperty(config, path + "config.", "enable_watchdog", "bool", false);
+	addProperty(config, path + "config.", "watchdog_timeout", "float", false, floatBits(0.f));
+	members.push_back({ { "name", "config" }, { "type", "object" }, { "members", config } });
+
+	nlohmann::json motor = nlohmann::json::array();
+	addProperty(motor, path + "motor.", "error", "uint64", false);
+	nlohmann::json currentControl = nlohmann::json::array();
+	addProperty(currentControl, path + "motor.current_control.", "Iq_setpoint", "float", true);
+	addProperty(currentControl, path + "motor.current_control.", "Iq_measured", "float", true);
+	motor.push_back({ { "name", "current_control" }, { "type", "object" }, { "members", currentControl } });
+	nlohmann::json motorConfig = nlohmann::json::array();
+	addProperty(motorConfig, path + "motor.config.", "current_lim", "float", false, floatBits(10.f));
+	addProperty(motorConfig, path + "motor.config.", "current_control_bandwidth", "float", false, floatBits(1000.f));
+	addProperty(motorConfig, path + "motor.config.", "pole_pairs", "int32", false, 7);
+	motor.push_back({ { "name", "config" }, { "type", "object" }, { "members", motorConfig } });
+	members.push_back({ { "name", "motor" }, { "type", "object" }, { "members", motor } });
+
+	nlohmann::json encoder = nlohmann::json::array();
+	addProperty(encoder, path + "encoder.", "error", "uint32", false);
+	addProperty(encoder, path + "encoder.", "pos_estimate", "float", true);
+	addProperty(encoder, path + "encoder.", "vel_estimate", "float", true);
+	addProperty(encoder, path + "encoder.", "shadow_count", "int32", true);
+	members.push_back({ { "name", "encoder" }, { "type", "object" }, { "members", encoder } });
+
+	nlohmann::json controller = nlohmann::json::array();
+	addProperty(controller, path + "controller.", "error", "uint32", false);
+	addProperty(controller, path + "controller.", "input_pos", "float", false);
+	addProperty(controller, path + "controller.", "input_vel", "float", false);
+	addProperty(controller, path + "controller.", "input_torque", "float", false);
+	nlohmann::json controllerConfig = nlohmann::json::array();
+	addProperty(controllerConfig, path + "controller.config.", "control_mode", "uint8", false, 3);
+	addProperty(controllerConfig, path + "controller.config.", "input_mode", "uint8", false, 1);
+	addProperty(controllerConfig, path + "controller.config.", "pos_gain", "float", false, floatBits(20.f));
+	addProperty(controllerConfig, path + "controller.config.", "vel_gain", "float", false, floatBits(0.16f));
+	addProperty(controllerConfig, path + "controller.config.", "vel_integrator_gain", "float", false, floatBits(0.32f));
+	addProperty(controllerConfig, path + "controller.config.", "vel_limit", "float", false, floatBits(2.f));
+	controller.push_back({ { "name", "config" }, { "type", "object" }, { "members", controllerConfig } });
+	addFunction(controller, path + "controller.", "move_incremental", [this, path] {
+		std::string function = path + "controller.move_incremental.";
+		float start = getInt(function + "from_input_pos") ? getFloat(path + "controller.input_pos") : getFloat(path + "encoder.pos_estimate");
+		setFloat(path + "controller.input_pos", start + getFloat(function + "displacement"));
+	}, { { "displacement", "float" }, { "from_input_pos", "bool" } });
+	members.push_back({ { "name", "controller" }, { "type", "object" }, { "members", controller } });
+
+	addFunction(members, path, "clear_errors", [this, path] {
+		setInt(path + "error", 0);
+		setInt(path + "motor.error", 0);
+		setInt(path + "encoder.error", 0);
+		setInt(path + "controller.error", 0);
+	});
+	addFunction(members, path, "watchdog_feed", [this, axis] {
+		axes[axis].lastFeed = Battery::GetRuntime();
+	});
+
+	return { { "name", "axis" + std::to_string(axis) }, { "type", "object" }, { "members", members } };
+}
+
+float EmulatedTransport::getFloat(const std::string& path) {
+	float value = 0.f;
+	memcpy(&value, &properties[ids[path]].value, sizeof(value));
+	return value;
+}
+
+void EmulatedTransport::setFloat(const std::string& path, float value) {
+	properties[ids[path]].value = floatBits(value);
+}
+
+uint64_t EmulatedTransport::getInt(const std::string& path) {
+	return properties[ids[path]].value;
+}
+
+void EmulatedTransport::setInt(const std::string& path, uint64_t value) {
+	properties[ids[path]].value = value;
+}
+
+bool EmulatedTransport::write(const uint8_t* data, size_t length) {
+	if (length < 8)
+		return false;
+
+	uint16_t sequence = data[0] | data[1] << 8;
+	uint16_t endpointID = data[2] | data[3] << 8;
+	uint16_t expectedSize = data[4] | data[5] << 8;
+
+	std::lock_guard<std::mutex> lock(mutex);
+	if (detached)
+		return false;
+	handleRequest(sequence, endpointID, expectedSize, data + 6, length - 8);
+	return true;
+}
+
+buffer_t EmulatedTransport::read(size_t maxLength) {
+	std::unique_lock<std::mutex> lock(mutex);
+	if (detached || responses.empty()) {	// Nothing was requested, behave like a USB timeout
+		lock.unlock();
+		std::this_thread::sleep_for(std::chrono::duration<double>(latency));
+		return buffer_t();
+	}
+
+	Response response = std::move(responses.front());
+	responses.pop_front();
+	lock.unlock();
+
+	std::this_thread::sleep_until(response.ready);
+	if (response.data.size() > maxLength) {
+		response.data.resize(maxLength);
+	}
+	return response.data;
+}
+
+std::shared_ptr<EmulatedTransport> EmulatedTransport::rebooted() {
+	std::lock_guard<std::mutex> lock(mutex);
+	if (!detached || replaced || Battery::GetRuntime() < rebootEnd)
+		return nullptr;
+	replaced = true;
+
+	auto next = std::make_shared<EmulatedTransport>(serialNumber, latency);
+	for (size_t id = 0; id < properties.size(); id++) {		// Built the same way, so the ids match
+		if (!properties[id].function) {
+			next->properties[id].value = properties[id].value;
+		}
+	}
+	next->properties[next->ids["clear_errors"]].function();
+	for (int axis = 0; axis < 2; axis++) {
+		std::string path = "axis" + std::to_string(axis) + ".";
+		next->setInt(path + "current_state", 1);
+		next->setInt(path + "requested_state", 0);
+		next->writeAxisModel(path, next->getFloat(path + "encoder.pos_estimate"), 0.0, 0.0);
+	}
+	return next;
+}
+
+void EmulatedTransport::handleRequest(uint16_t sequence, uint16_t endpointID, uint16_t expectedSize, const uint8_t* payload, size_t payloadSize) {
+
+	bool ackRequested = endpointID & 0x8000;
+	uint16_t id = endpointID & 0x7FFF;
+	if (id >= properties.size())
+		return;
+
+	simulate();
+
+	buffer_t output;
+	if (id == 0) {		// JSON definition, the payload is the offset
+		uint32_t offset = 0;
+		if (payloadSize >= sizeof(offset)) {
+			memcpy(&offset, payload, sizeof(offset));
+		}
+		if (offset < json.size()) {
+			size_t count = std::min<size_t>(expectedSize, json.size() - offset);
+			output.insert(output.end(), json.begin() + offset, json.begin() + offset + count);
+		}
+	}
+	else if (properties[id].type == "function") {
+		properties[id].function();
+	}
+	else {
+		Property& property = properties[id];
+		size_t size = typeSize(property.type);
+		if (payloadSize >= size && size > 0) {
+			uint64_t value = 0;
+			memcpy(&value, payload, size);
+			property.value = value;
+			propertyWritten(id);
+		}
+		uint64_t value = property.value;
+		output.resize(std::min<size_t>(expectedSize, sizeof(value)));
+		memcpy(output.data(), &value, output.size());
+	}
+
+	if (ackRequested && !detached) {
+		Response response;
+		response.data.push_back((uint8_t)(sequence));
+		response.data.push_back((uint8_t)((sequence >> 8) | 0x80));
+		response.data.insert(response.data.end(), output.begin(), output.end());
+		response.ready = std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(latency));
+		responses.push_back(std::move(response));
+	}
+}
+
+void EmulatedTransport::propertyWritten(uint16_t id) {
+	for (int axis = 0; axis < 2; axis++) {
+		std::string path = "axis" + std::to_string(axis) + ".";
+		if (id != ids[path + "requested_state"])
+			continue;
+
+		uint64_t state = getInt(path + "requested_state");
+		setInt(path + "requested_state", 0);	// The firmware consumes the request
+
+		if (state == 1) {
+			setInt(path + "current_state", 1);
+		}
+		else if (getInt(path + "error") != 0) {
+			setInt(path + "current_state", 1);	// Refuse to leave idle while an error is active
+		}
+		else if (state == 3 || state == 4 || state == 6 || state == 7) {
+			setInt(path + "current_state", state);
+			axes[axis].calibrationEnd = Battery::GetRuntime() + EMULATED_CALIBRATION_TIME;
+		}
+		else if (state == 8) {
+			setInt(path + "current_state", 8);
+			axes[axis].lastFeed = Battery::GetRuntime();
+			setFloat(path + "controller.input_pos", getFloat(path + "encoder.pos_estimate"));
+		}
+	}
+}
+
+void EmulatedTransport::simulate() {
+	double now = Battery::GetRuntime();
+	double dt = std::min(now - lastSimulation, 0.1);
+	lastSimulation = now;
+
+	struct AxisStep {
+		std::string path;
+		bool closedLoop = false;
+		uint64_t mode = 0;
+		double posGain = 0.0, velGain = 0.0, velLimit = 0.0, maxTorque = 0.0;
+		double inputPos = 0.0, inputVel = 0.0, inputTorque = 0.0;
+		double pos = 0.0, vel = 0.0, torque = 0.0;
+	};
+	std::array<AxisStep, 2> steps;
+
+	for (int axis = 0; axis < 2; axis++) {
+		AxisStep& step = steps[axis];
+		std::string& path = step.path;
+		path = "axis" + std::to_string(axis) + ".";
+		uint64_t state = getInt(path + "current_state");
+
+		if (state >= 3 && state <= 7 && now >= axes[axis].calibrationEnd) {
+			setInt(path + "current_state", 1);
+			state = 1;
+		}
+
+		if (state == 8 && getInt(path + "config.enable_watchdog") &&
+			now - axes[axis].lastFeed > getFloat(path + "config.watchdog_timeout")) {
+			setInt(path + "error", getInt(path + "error") | 0x800);		// AXIS_ERROR_WATCHDOG_TIMER_EXPIRED
+			setInt(path + "current_state", 1);
+			state = 1;
+		}
+
+		step.closedLoop = state == 8;
+		step.mode = getInt(path + "controller.config.control_mode");
+		step.posGain = getFloat(path + "controller.config.pos_gain");
+		step.velGain = getFloat(path + "controller.config.vel_gain");
+		step.velLimit = getFloat(path + "controller.config.vel_limit");
+		step.maxTorque = getFloat(path + "motor.config.current_lim") * EMULATED_TORQUE_CONSTANT;
+		step.inputPos = getFloat(path + "controller.input_pos");
+		step.inputVel = getFloat(path + "controller.input_vel");
+		step.inputTorque = getFloat(path + "controller.input_torque");
+		step.pos = getFloat(path + "encoder.pos_estimate");
+		step.vel = getFloat(path + "encoder.vel_estimate");
+	}
+
+	// One iteration is one control loop cycle of both axes. The model outputs are only written
+	// back at the end, unless the scope needs them for every cycle.
+	for (double t = 0.0; t < dt; t += EMULATED_SIMULATION_STEP) {
+		double h = std::min(EMULATED_SIMULATION_STEP, dt - t);
+		for (AxisStep& step : steps) {
+			if (step.closedLoop) {
+				double velSetpoint = (step.mode == 3) ? step.posGain * (step.inputPos - step.pos) + step.inputVel : step.inputVel;
+				velSetpoint = std::clamp(velSetpoint, -step.velLimit, step.velLimit);
+				step.torque = (step.mode >= 2) ? step.velGain * (velSetpoint - step.vel) + step.inputTorque : step.inputTorque;
+				step.torque = std::clamp(step.torque, -step.maxTorque, step.maxTorque);
+				step.vel += step.torque / EMULATED_INERTIA * h;
+			}
+			else {		// Coasting
+				step.torque = 0.0;
+				step.vel *= std::exp(-h * 5.0);
+			}
+			step.pos += step.vel * h;
+		}
+
+		if (scope.capturing) {
+			for (AxisStep& step : steps) {
+				writeAxisModel(step.path, step.pos, step.vel, step.torque);
+			}
+			sampleScope();
+		}
+	}
+
+	for (AxisStep& step : steps) {
+		writeAxisModel(step.path, step.pos, step.vel, step.torque);
+	}
+}
+
+void EmulatedTransport::writeAxisModel(const std::string& path, double pos, double vel, double torque) {
+	setFloat(path + "encoder.pos_estimate", (float)pos);
+	setFloat(path + "encoder.vel_estimate", (float)vel);
+	setFloat(path + "motor.current_control.Iq_setpoint", (float)(torque / EMULATED_TORQUE_CONSTANT));
+	setFloat(path + "motor.current_control.Iq_measured", (float)(torque / EMULATED_TORQUE_CONSTANT));
+}
+
+void EmulatedTransport::sampleScope() {
+	if (scope.cycle++ % std::max<uint64_t>(getInt("oscilloscope.config.decimation"), 1) != 0)
+		return;
+
+	uint64_t channels = std::clamp<uint64_t>(getInt("oscilloscope.config.channels"), 1, EMULATED_SCOPE_CHANNELS);
+	if (scope.buffer.size() + channels > EMULATED_SCOPE_SIZE) {
+		scope.capturing = false;
+		return;
+	}
+
+	for (uint64_t c = 0; c < channels; c++) {
+		uint64_t source = getInt("oscilloscope.config.source" + std::to_string(c));
+		scope.buffer.push_back(source > 0 && source < properties.size() ? propertyAsFloat(properties[source]) : 0.f);
+	}
+	setInt("oscilloscope.pos", scope.buffer.size());
+}
+
+float EmulatedTransport::propertyAsFloat(const Property& property) {
+	if (property.type == "float") {
+		float value = 0.f;
+		memcpy(&value, &property.value, sizeof(value));
+		return value;
+	}
+	if (property.type == "int32") {
+		return (float)(int32_t)property.value;
+	}
+	return (float)property.value;
+}
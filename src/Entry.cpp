@@ -55,41 +55,55 @@ Entry::Entry(const nlohmann::json& json) {
 	}
 }
 
-void Entry::updateValue() {
-	std::unique_lock<std::mutex> lock(mutex);
+void Entry::updateValue(std::vector<ValueChange>& samples) {
 
-	// Update the changed flags
-	oldValues[endpoint->fullPath] = value;
-	for (Endpoint& e : endpoint.inputs) {
-		oldValues[e->fullPath] = ioValues[e->fullPath];
-	}
-	for (Endpoint& e : endpoint.outputs) {
-		oldValues[e->fullPath] = ioValues[e->fullPath];
-	}
-	lock.unlock();
-
-	// And now read
-	auto temp = backend->readEndpointDirect(endpoint.basic);
+	SampleTime time;
+	auto temp = backend->readEndpointDirect(endpoint.basic, &time);
 	if (temp.type() != EndpointValueType::INVALID) {
-		lock.lock();
+		std::scoped_lock<std::mutex> lock(mutex);
 		value = temp;
-		lock.unlock();
+		valueTime = time;
+		samples.push_back({ endpoint->handle(), temp, time });
 	}
 
 	for (Endpoint& e : endpoint.inputs) {
-		auto temp = backend->readEndpointDirect(e.basic);
+		auto temp = backend->readEndpointDirect(e.basic, &time);
 		if (temp.type() != EndpointValueType::INVALID) {
-			lock.lock();
+			std::scoped_lock<std::mutex> lock(mutex);
 			ioValues[e->fullPath] = temp;
-			lock.unlock();
+			ioTimes[e->fullPath] = time;
+			samples.push_back({ e->handle(), temp, time });
 		}
 	}
 	for (Endpoint& e : endpoint.outputs) {
-		auto temp = backend->readEndpointDirect(e.basic);
+		auto temp = backend->readEndpointDirect(e.basic, &time);
 		if (temp.type() != EndpointValueType::INVALID) {
-			lock.lock();
+			std::scoped_lock<std::mutex> lock(mutex);
 			ioValues[e->fullPath] = temp;
-			lock.unlock();
+			ioTimes[e->fullPath] = time;
+			samples.push_back({ e->handle(), temp, time });
+		}
+	}
+}
+
+void Entry::applySamples(const std::vector<ValueChange>& samples) {
+	std::scoped_lock<std::mutex> lock(mutex);
+	for (const ValueChange& sample : samples) {
+		if (sample.handle == endpoint->handle()) {
+			value = sample.value;
+			valueTime = sample.time;
+		}
+		for (Endpoint& e : endpoint.inputs) {
+			if (sample.handle == e->handle()) {
+				ioValues[e->fullPath] = sample.value;
+				ioTimes[e->fullPath] = sample.time;
+			}
+		}
+		for (Endpoint& e : endpoint.outputs) {
+			if (sample.handle == e->handle()) {
+				ioValues[e->fullPath] = sample.value;
+				ioTimes[e->fullPath] = sample.time;
+			}
 		}
 	}
 }
@@ -145,8 +159,7 @@ void Entry::drawImGuiNumberInput(Endpoint& ep, bool isfloat) {
 	if (set) {
 		try {
 			if (writeValue.toString().length() > 0) {
-				backend->writeEndpointDirect(ep.basic, writeValue);
-				backend->updateEntryCache();
+				backend->writeEndpointVerified(ep.basic, writeValue);
 				LOG_DEBUG("Setting {} to {}", ep->fullPath, writeValue.toString());
 			}
 			else {
@@ -157,6 +170,8 @@ void Entry::drawImGuiNumberInput(Endpoint& ep, bool isfloat) {
 			load = true;
 		}
 	}
+	drawVerification(ep);
+
 	if (load || std::string(imguiBuffer) == "") {
 		EndpointValue value = backend->readEndpointDirect(ep.basic);
 		if (value.type() != EndpointValueType::INVALID) {
@@ -169,13 +184,34 @@ void Entry::drawImGuiBoolInput(Endpoint& ep) {
 	ImGui::SameLine();
 	ImGui::SetCursorPosX(ImGui::GetWindowWidth() - 145);
 	if (ImGui::Button(("false##" + ep->fullPath + std::to_string(entryID)).c_str(), { 60, 0 })) {
-		backend->writeEndpointDirect(ep.basic, false);
-		backend->updateEntryCache();
+		backend->writeEndpointVerified(ep.basic, false);
 	}
 	ImGui::SameLine();
 	if (ImGui::Button(("true##" + ep->fullPath + std::to_string(entryID)).c_str(), { 60, 0 })) {
-		backend->writeEndpointDirect(ep.basic, true);
-		backend->updateEntryCache();
+		backend->writeEndpointVerified(ep.basic, true);
+	}
+	drawVerification(ep);
+}
+
+void Entry::drawVerification(Endpoint& ep) {
+	auto result = backend->verifiedWriter.recentResult(ep->handle());
+	if (!result || result->success)		// Successful writes are visible as the changed value
+		return;
+
+	ImGui::SameLine();
+	ImGui::TextColored(RED, "!");
+	if (ImGui::IsItemHovered()) {
+		ImGui::BeginTooltip();
+		if (!result->acknowledged) {
+			ImGui::Text("The write was not acknowledged");
+		}
+		if (result->readBack.type() == EndpointValueType::INVALID) {
+			ImGui::Text("Wrote %s, reading it back failed", result->written.toString().c_str());
+		}
+		else {
+			ImGui::Text("Wrote %s, but it reads %s", result->written.toString().c_str(), result->readBack.toString().c_str());
+		}
+		ImGui::EndTooltip();
 	}
 }
 
@@ -191,7 +227,50 @@ void Entry::drawEndpointInput(Endpoint& ep) {
 	}
 }
 
-void Entry::draw() {
+void Entry::drawArgumentInput(Endpoint& ep) {
+	ImGui::SameLine();
+	ImGui::SetCursorPosX(ImGui::GetWindowContentRegionWidth() - 145);
+	ImGui::PushItemWidth(100);
+	auto& buffer = arguments[ep->fullPath];
+	ImGui::InputText(("##" + ep->fullPath + std::to_string(entryID)).c_str(), buffer.data(), IMGUI_BUFFER_SIZE, ep.getImGuiFlags());
+	ImGui::PopItemWidth();
+}
+
+// Empty fields take the current value of the input
+bool Entry::collectArguments(std::vector<EndpointValue>& inputs) {
+	for (Endpoint& ep : endpoint.inputs) {
+		std::string text = arguments[ep->fullPath].data();
+		EndpointValue value(ep->type);
+
+		if (text.empty()) {
+			value = ioValues[ep->fullPath];
+		}
+		else if (value.type() == EndpointValueType::BOOL) {
+			value.set<bool>(text == "true" || text == "1");
+		}
+		else if (!value.fromString(text)) {
+			LOG_ERROR("Cannot call {}(): '{}' is not a valid {} for {}", endpoint->fullPath, text, ep->type, ep->name);
+			return false;
+		}
+
+		if (value.type() == EndpointValueType::INVALID) {
+			LOG_ERROR("Cannot call {}(): No value for {}", endpoint->fullPath, ep->name);
+			return false;
+		}
+		inputs.push_back(value);
+	}
+	return true;
+}
+
+static bool recentlyChanged(const std::unordered_map<EndpointHandle, double>& changeTimes, const BasicEndpoint& ep) {
+	auto it = changeTimes.find(ep.handle());
+	if (it == changeTimes.end())
+		return false;
+
+	return Battery::GetRuntime() - it->second < CHANGE_HIGHLIGHT_DURATION;
+}
+
+void Entry::draw(const std::unordered_map<EndpointHandle, double>& changeTimes) {
 	std::scoped_lock<std::mutex> lock(mutex);
 
 	ImGui::SetCursorPosY(ImGui::GetCursorPosY() + 10);
@@ -203,7 +282,7 @@ void Entry::draw() {
 		}
 		ImGui::SameLine();
 
-		bool changed = (value != oldValues[endpoint->fullPath]);	// vvv Test if an enum name is available for this endpoint
+		bool changed = recentlyChanged(changeTimes, endpoint.basic);	// vvv Test if an enum name is available for this endpoint
 		const std::string& enumName = EndpointValueToEnumName(endpoint.basic, value.get<int64_t>(), value.type());
 		drawEndpointChildWindow(endpoint->fullPath.c_str(), endpoint->type.c_str(), value.toString(), endpoint.getColor(), enumName, value.get<int64_t>(), changed, entryID);
 		if (!endpoint->readonly) {
@@ -223,7 +302,10 @@ void Entry::draw() {
 		ImGui::SameLine();
 		ImGui::SetCursorPosX(ImGui::GetWindowWidth() - 120);
 		if (ImGui::Button(("Execute##" + endpoint->fullPath).c_str(), { 90, 0 })) {
-			backend->executeFunction(endpoint->odriveID, endpoint->identifier);
+			std::vector<EndpointValue> inputs;
+			if (collectArguments(inputs)) {
+				backend->executeFunction(endpoint->odriveID, endpoint->identifier, inputs);
+			}
 		}
 
 		ImGui::SetCursorPosY(ImGui::GetCursorPosY() + 10);
@@ -239,11 +321,9 @@ void Entry::draw() {
 
 			ImGui::SetCursorPosX(120);
 
-			bool changed = (value != oldValues[ep->fullPath]);
+			bool changed = recentlyChanged(changeTimes, ep.basic);
 			drawEndpointChildWindow(ep->identifier.c_str(), ep->type.c_str(), value.toString(), ep.getColor(), "", 0, changed, entryID);
-			if (!ep->readonly) {
-				drawEndpointInput(ep);
-			}
+			drawArgumentInput(ep);		// Sent together with the call
 
 			ImGui::SetCursorPosY(ImGui::GetCursorPosY() + 10);
 		}
@@ -259,7 +339,7 @@ void Entry::draw() {
 
 			ImGui::SetCursorPosX(120);
 
-			bool changed = (value != oldValues[ep->fullPath]);
+			bool changed = recentlyChanged(changeTimes, ep.basic);
 			drawEndpointChildWindow(ep->identifier.c_str(), ep->type.c_str(), value.toString(), ep.getColor(), "", 0, changed, entryID);
 			if (!ep->readonly) {
 				drawEndpointInput(ep);
@@ -0,0 +1,65 @@
+
+#include "pch.h"
+#include "EntryList.h"
+
+void EntryList::add(const Entry& entry) {
+	auto storage = std::make_shared<Entry>(entry);
+	generation.update([&](Generation& next) {
+		next.indices[storage->entryID] = next.entries.size();
+		next.entries.push_back(storage);
+	});
+}
+
+void EntryList::remove(size_t entryID) {
+	generation.update([&](Generation& next) {
+		auto it = next.indices.find(entryID);
+		if (it == next.indices.end())
+			return;
+
+		size_t index = it->second;
+		next.entries.erase(next.entries.begin() + index);
+		next.indices.erase(it);
+		reindex(next, index);
+	});
+}
+
+void EntryList::replace(const std::vector<Entry>& newEntries) {
+	generation.update([&](Generation& next) {
+		next.entries.clear();
+		next.indices.clear();
+		for (const Entry& entry : newEntries) {
+			next.entries.push_back(std::make_shared<Entry>(entry));
+		}
+		reindex(next, 0);
+	});
+}
+
+void EntryList::clear() {
+	generation.update([](Generation& next) {
+		next.entries.clear();
+		next.indices.clear();
+	});
+}
+
+std::shared_ptr<Entry> EntryList::get(size_t entryID) const {
+	auto current = generation.read();
+	auto it = current->indices.find(entryID);
+	if (it == current->indices.end())
+		return nullptr;
+
+	return current->entries[it->second];
+}
+
+std::vector<std::shared_ptr<Entry>> EntryList::list() const {
+	return generation.read()->entries;
+}
+
+size_t EntryList::size() const {
+	return generation.read()->entries.size();
+}
+
+void EntryList::reindex(Generation& generation, size_t first) {
+	for (size_t i = first; i < generation.entries.size(); i++) {
+		generation.indices[generation.entries[i]->entryID] = i;
+	}
+}
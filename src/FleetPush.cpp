@@ -0,0 +1,135 @@
+
+#include "pch.h"
+#include "FleetPush.h"
+
+const char* FleetPush::StageName(Stage stage) {
+	switch (stage) {
+	case Stage::QUEUED:			return "Queued";
+	case Stage::CONFIGURING:	return "Configuring";
+	case Stage::SAVING:			return "Saving";
+	case Stage::REBOOTING:		return "Rebooting";
+	case Stage::DONE:			return "Done";
+	case Stage::FAILED:			return "Failed";
+	}
+	return "Unknown";
+}
+
+bool FleetPush::start(const std::vector<int>& odriveIDs, const ConfigTransaction& parameters,
+	const std::map<int, ConfigTransaction>& overrides, bool save, bool reboot) {
+
+	if (running()) {
+		LOG_ERROR("Cannot push configuration: The previous push is still running");
+		return false;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		devices.clear();
+		for (int id : odriveIDs) {
+			DeviceProgress device;
+			device.odriveID = id;
+			devices.push_back(device);
+		}
+		started = Battery::GetRuntime();
+	}
+
+	active = odriveIDs.size();
+	for (size_t i = 0; i < odriveIDs.size(); i++) {
+		ConfigTransaction transaction = parameters;
+		auto it = overrides.find(odriveIDs[i]);
+		if (it != overrides.end()) {
+			transaction.merge(it->second);
+		}
+		transaction.save(false);		// Saving is a stage of its own
+
+		executor.post([this, i, transaction, save, reboot] {
+			push(i, transaction, save, reboot);
+		});
+	}
+	return true;
+}
+
+std::vector<FleetPush::DeviceProgress> FleetPush::progress() const {
+	std::lock_guard<std::mutex> lock(mutex);
+	return devices;
+}
+
+void FleetPush::finished() {
+	if (--active == 0) {
+		LOG_INFO("Configuration pushed to {} drives in {:.1f} ms", devices.size(), (Battery::GetRuntime() - started) * 1000.0);
+	}
+}
+
+void FleetPush::setStage(size_t index, Stage stage, const std::string& message) {
+	std::lock_guard<std::mutex> lock(mutex);
+	devices[index].stage = stage;
+	devices[index].duration = Battery::GetRuntime() - started;
+	if (!message.empty()) {
+		devices[index].message = message;
+		LOG_ERROR("Configuration push to odrv{} failed: {}", devices[index].odriveID, message);
+	}
+}
+
+void FleetPush::push(size_t index, ConfigTransaction transaction, bool save, bool reboot) {
+
+	TransferPriorityScope priority(TransferPriority::INTERACTIVE);
+	int odriveID = devices[index].odriveID;		// Never changes after start()
+	auto odrive = registry.get(odriveID);
+	if (!odrive || !*odrive) {
+		setStage(index, Stage::FAILED, "Not connected");
+		finished();
+		return;
+	}
+
+	setStage(index, Stage::CONFIGURING);
+	ConfigTransaction::Result result = transaction.commit(*odrive);
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		devices[index].result = result;
+	}
+	if (!result.success) {
+		setStage(index, Stage::FAILED, "Not all parameters were verified");
+		finished();
+		return;
+	}
+
+	if (save) {
+		setStage(index, Stage::SAVING);
+		if (!odrive->saveConfiguration()) {
+			setStage(index, Stage::FAILED, "save_configuration failed");
+			finished();
+			return;
+		}
+	}
+
+	if (reboot) {
+		setStage(index, Stage::REBOOTING);
+		odrive->call("reboot");		// The device is gone before it can answer
+		executor.spawn(waitForReconnect(index, odrive));
+		return;
+	}
+
+	setStage(index, Stage::DONE);
+	finished();
+}
+
+Task<void> FleetPush::waitForReconnect(size_t index, std::shared_ptr<ODrive> previous) {
+
+	// A reconnected drive is a new ODrive object under the same ID, registered by the USB listener
+	int odriveID = devices[index].odriveID;
+	double start = Battery::GetRuntime();
+	bool reconnected = false;
+	while (!reconnected && Battery::GetRuntime() - start < FLEET_RECONNECT_TIMEOUT) {
+		co_await executor.sleep(FLEET_RECONNECT_POLL);
+		auto current = registry.get(odriveID);
+		reconnected = current && current != previous && *current;
+	}
+
+	if (reconnected) {
+		setStage(index, Stage::DONE);
+	}
+	else {
+		setStage(index, Stage::FAILED, "Did not reconnect after rebooting");
+	}
+	finished();
+}
@@ -0,0 +1,221 @@
+
+#include "pch.h"
+#include "FrequencyResponse.h"
+#include "RequestBatch.h"
+
+static const double PI = 3.14159265358979323846;
+
+double FrequencyResponse::Excitation(const BodeSettings& settings, double t) {
+
+	double f0 = settings.startFrequency;
+	double f1 = settings.endFrequency;
+
+	if (settings.signal == ExcitationSignal::CHIRP) {
+		double k = f1 / f0;
+		double phase = 2.0 * PI * f0 * settings.duration / std::log(k) * (std::pow(k, t / settings.duration) - 1.0);
+		return settings.amplitude * std::sin(phase);
+	}
+
+	// Schroeder phases keep the crest factor low, so the sum peaks at roughly 1.5 times its RMS
+	const int tones = BODE_MULTISINE_TONES;
+	double toneAmplitude = settings.amplitude / (1.5 * std::sqrt(tones / 2.0));
+	double sum = 0.0;
+	for (int m = 0; m < tones; m++) {
+		double f = f0 * std::pow(f1 / f0, (double)m / (tones - 1));
+		sum += std::sin(2.0 * PI * f * t - PI * m * (m - 1) / tones);
+	}
+	return std::clamp(toneAmplitude * sum, -settings.amplitude, settings.amplitude);
+}
+
+void FrequencyResponse::FFT(std::vector<std::complex<double>>& data) {
+
+	size_t n = data.size();
+	for (size_t i = 1, j = 0; i < n; i++) {		// Bit reversal
+		size_t bit = n >> 1;
+		for (; j & bit; bit >>= 1) {
+			j ^= bit;
+		}
+		j ^= bit;
+		if (i < j) {
+			std::swap(data[i], data[j]);
+		}
+	}
+
+	for (size_t length = 2; length <= n; length <<= 1) {
+		double angle = -2.0 * PI / length;
+		std::complex<double> step(std::cos(angle), std::sin(angle));
+		for (size_t i = 0; i < n; i += length) {
+			std::complex<double> w(1.0, 0.0);
+			for (size_t k = 0; k < length / 2; k++) {
+				std::complex<double> even = data[i + k];
+				std::complex<double> odd = data[i + k + length / 2] * w;
+				data[i + k] = even + odd;
+				data[i + k + length / 2] = even - odd;
+				w *= step;
+			}
+		}
+	}
+}
+
+std::vector<BodePoint> FrequencyResponse::Estimate(const std::vector<double>& input, const std::vector<double>& output,
+	double rate, double minFrequency, double maxFrequency) {
+
+	size_t n = std::min(input.size(), output.size());
+	if (n < 16)
+		return {};
+
+	// One transform over the whole record, zero padded to a power of two. A chirp only has energy
+	// at a frequency for a short time, so splitting the record into segments would lose most of it.
+	size_t segment = 1;
+	while (segment < n) {
+		segment <<= 1;
+	}
+
+	double uMean = 0.0;
+	double yMean = 0.0;
+	for (size_t i = 0; i < n; i++) {
+		uMean += input[i];
+		yMean += output[i];
+	}
+	uMean /= n;
+	yMean /= n;
+
+	std::vector<std::complex<double>> u(segment);
+	std::vector<std::complex<double>> y(segment);
+	for (size_t i = 0; i < n; i++) {
+		u[i] = input[i] - uMean;
+		y[i] = output[i] - yMean;
+	}
+	FFT(u);
+	FFT(y);
+
+	size_t bins = segment / 2;
+	std::vector<std::complex<double>> crossSpectrum(bins);
+	std::vector<double> inputSpectrum(bins);
+	std::vector<double> outputSpectrum(bins);
+	for (size_t k = 0; k < bins; k++) {
+		crossSpectrum[k] = y[k] * std::conj(u[k]);
+		inputSpectrum[k] = std::norm(u[k]);
+		outputSpectrum[k] = std::norm(y[k]);
+	}
+
+	// Sum the bins into logarithmically spaced points
+	double resolution = rate / segment;
+	minFrequency = std::max(minFrequency, resolution);
+	maxFrequency = std::min(maxFrequency, rate / 2.0);
+	std::vector<BodePoint> points;
+	double previousPhase = 0.0;
+	double phaseOffset = 0.0;
+	for (int p = 0; p < BODE_PLOT_POINTS; p++) {
+		double low = minFrequency * std::pow(maxFrequency / minFrequency, (double)p / BODE_PLOT_POINTS);
+		double high = minFrequency * std::pow(maxFrequency / minFrequency, (double)(p + 1) / BODE_PLOT_POINTS);
+		size_t first = (size_t)std::ceil(low / resolution);
+		size_t last = std::min((size_t)std::ceil(high / resolution), bins);
+
+		std::complex<double> cross = 0.0;
+		double inputPower = 0.0;
+		double outputPower = 0.0;
+		double frequency = 0.0;
+		for (size_t k = first; k < last; k++) {
+			cross += crossSpectrum[k];
+			inputPower += inputSpectrum[k];
+			outputPower += outputSpectrum[k];
+			frequency += k * resolution;
+		}
+		if (last <= first || inputPower <= 0.0)
+			continue;
+
+		std::complex<double> h = cross / inputPower;
+		BodePoint point;
+		point.frequency = frequency / (last - first);
+		point.magnitude = 20.0 * std::log10(std::abs(h));
+
+		// Coherence over the bins of the point, close to 1 if they all agree on the same transfer function
+		point.coherence = outputPower > 0.0 ? std::norm(cross) / (inputPower * outputPower) : 0.0;
+
+		// Unwrapped, so the phase doesn't jump by 360 degrees
+		double phase = std::arg(h) * 180.0 / PI;
+		if (!points.empty()) {
+			if (phase + phaseOffset - previousPhase > 180.0) phaseOffset -= 360.0;
+			if (phase + phaseOffset - previousPhase < -180.0) phaseOffset += 360.0;
+		}
+		point.phase = phase + phaseOffset;
+		previousPhase = point.phase;
+		points.push_back(point);
+	}
+	return points;
+}
+
+BodeResult FrequencyResponse::Run(std::shared_ptr<ODrive> odrive, const BodeSettings& settings) {
+
+	TransferPriorityScope priority(TransferPriority::INTERACTIVE);
+	BodeResult result;
+	std::string axis = "axis" + std::to_string(settings.axis) + ".";
+	auto input = odrive->findEndpoint(axis + (settings.input == ExcitationInput::VELOCITY ? "controller.input_vel" : "controller.input_torque"));
+	auto response = odrive->findEndpoint(axis + "encoder.vel_estimate");
+	if (!input || !response || input->type != "float") {
+		result.error = "The axis has no velocity or torque input";
+		return result;
+	}
+	if (settings.rate <= 0.0 || settings.startFrequency <= 0.0 || settings.endFrequency <= settings.startFrequency || settings.endFrequency > settings.rate / 2.0) {
+		result.error = "The frequencies must be increasing and below half the rate";
+		return result;
+	}
+
+	float offset = 0.f;
+	if (!odrive->inClosedLoopControl(settings.axis) || !odrive->read<float>(input->identifier, &offset)) {
+		result.error = "The axis is not in closed loop control";
+		return result;
+	}
+
+	// Everything is allocated up front, the loop only fills it
+	size_t count = (size_t)(settings.duration * settings.rate);
+	std::vector<double> written(count);
+	std::vector<double> measured(count);
+
+	RequestBatch batch;
+	size_t writeIndex = batch.addWrite(*input, EndpointValue(offset));
+	size_t readIndex = batch.addRead(*response);
+
+	using clock = std::chrono::steady_clock;
+	auto period = std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(1.0 / settings.rate));
+	auto start = clock::now();
+	double previous = 0.0;
+
+	for (size_t k = 0; k < count; k++) {
+		auto scheduled = start + period * (long long)k;
+		std::this_thread::sleep_until(scheduled);
+		if (clock::now() - scheduled > period) {
+			result.late++;
+		}
+
+		// The signal follows the schedule, not the actual send time, so it stays uniform for the FFT
+		float value = offset + (float)Excitation(settings, k / settings.rate);
+		batch.setValue(writeIndex, EndpointValue(value));
+		written[k] = value;
+
+		if (odrive->transact(batch)) {
+			previous = batch.results[readIndex].toDouble();
+		}
+		else {
+			result.failed++;
+			if (!odrive->connected) {
+				result.error = "The device stopped answering";
+				return result;
+			}
+		}
+		measured[k] = previous;
+	}
+	result.duration = std::chrono::duration<double>(clock::now() - start).count();
+	odrive->write<float>(input->identifier, offset);
+	result.samples = count;
+
+	result.points = Estimate(written, measured, settings.rate, settings.startFrequency, settings.endFrequency);
+	result.success = !result.points.empty();
+	if (!result.success) {
+		result.error = "Too few samples for the FFT";
+	}
+	LOG_INFO("Frequency response of odrv{} {}: {} samples in {:.2f} s, {} late, {} failed",
+		odrive->odriveID, input->identifier, count, result.duration, result.late, result.failed);
+	return result;
+}
@@ -0,0 +1,67 @@
+
+#include "pch.h"
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+MappedFile::MappedFile(const std::string& path) {
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+		return;
+	fileHandle = file;
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0)
+		return;
+
+	mappingHandle = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (!mappingHandle)
+		return;
+
+	begin = (const char*)MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+	length = begin ? (size_t)fileSize.QuadPart : 0;
+}
+
+MappedFile::~MappedFile() {
+	if (begin) UnmapViewOfFile(begin);
+	if (mappingHandle) CloseHandle(mappingHandle);
+	if (fileHandle) CloseHandle(fileHandle);
+}
+
+#else
+
+MappedFile::MappedFile(const std::string& path) {
+	descriptor = open(path.c_str(), O_RDONLY);
+	if (descriptor < 0)
+		return;
+
+	struct stat status;
+	if (fstat(descriptor, &status) != 0 || status.st_size == 0)
+		return;
+
+	void* mapping = mmap(nullptr, (size_t)status.st_size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+	if (mapping == MAP_FAILED)
+		return;
+
+	madvise(mapping, (size_t)status.st_size, MADV_SEQUENTIAL);
+	begin = (const char*)mapping;
+	length = (size_t)status.st_size;
+}
+
+MappedFile::~MappedFile() {
+	if (begin) munmap((void*)begin, length);
+	if (descriptor >= 0) close(descriptor);
+}
+
+#endif
@@ -0,0 +1,121 @@
+
+#include "pch.h"
+#include "RigCalibration.h"
+#include "WaitConditions.h"
+#include "ODriveDocs.h"
+
+void RigCalibration::start(const std::vector<int>& odriveIDs, int axis) {
+
+	if (isRunning || odriveIDs.empty())
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		devices.clear();
+		for (int id : odriveIDs) {
+			DeviceStatus status;
+			status.odriveID = id;
+			status.message = "Starting";
+			devices.push_back(status);
+		}
+	}
+
+	isRunning = true;
+	LOG_INFO("Starting full calibration of axis{} on {} drives", axis, odriveIDs.size());
+	executor.spawn(run(odriveIDs, axis));
+}
+
+Task<void> RigCalibration::run(std::vector<int> odriveIDs, int axis) {
+
+	std::string path = "axis" + std::to_string(axis) + ".";
+
+	// Request the calibration on every drive at once
+	std::vector<uint8_t> requested(odriveIDs.size(), false);	// Not vector<bool>, the jobs write it in parallel
+	std::vector<std::function<void()>> jobs;
+	for (size_t i = 0; i < odriveIDs.size(); i++) {
+		jobs.push_back([&, i] {
+			auto odrive = registry.get(odriveIDs[i]);
+			if (!odrive)
+				return;
+
+			auto endpoint = odrive->findEndpoint(path + "requested_state");
+			if (!endpoint)
+				return;
+
+			EndpointValue value(endpoint->type);
+			value.fromDouble(AxisRequestedState::AXIS_STATE_FULL_CALIBRATION_SEQUENCE);
+			requested[i] = odrive->writeValue(*endpoint, value);
+		});
+	}
+	co_await executor.all(std::move(jobs));
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		for (size_t i = 0; i < odriveIDs.size(); i++) {
+			devices[i].message = requested[i] ? "Calibrating" : "Request failed";
+			devices[i].finished = !requested[i];
+		}
+	}
+
+	// Give the drives a moment to leave idle, then wait until they are all back
+	co_await executor.sleep(WAIT_INITIAL_INTERVAL * 5);
+
+	std::vector<WaitCondition> conditions;
+	std::vector<size_t> indices;
+	for (size_t i = 0; i < odriveIDs.size(); i++) {
+		if (!requested[i])
+			continue;
+
+		WaitCondition condition;
+		condition.odriveID = odriveIDs[i];
+		condition.identifier = path + "current_state";
+		condition.predicate = [](const EndpointValue& v) { return (int32_t)v.toDouble() == (int32_t)AxisRequestedState::AXIS_STATE_IDLE; };
+		condition.timeout = CALIBRATION_TIMEOUT;
+		conditions.push_back(condition);
+		indices.push_back(i);
+	}
+	std::vector<WaitResult> results = co_await WaitForConditions(executor, registry, conditions);
+
+	// A calibration that ends in idle may still have failed, the axis error tells
+	std::vector<EndpointValue> errors(odriveIDs.size());
+	jobs.clear();
+	for (size_t i : indices) {
+		jobs.push_back([&, i] {
+			auto odrive = registry.get(odriveIDs[i]);
+			auto endpoint = odrive ? odrive->findEndpoint(path + "error") : nullptr;
+			if (endpoint) {
+				errors[i] = odrive->readValue(*endpoint);
+			}
+		});
+	}
+	co_await executor.all(std::move(jobs));
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		for (size_t r = 0; r < results.size(); r++) {
+			DeviceStatus& status = devices[indices[r]];
+			status.finished = true;
+			status.elapsed = results[r].elapsed;
+			uint64_t error = (uint64_t)errors[indices[r]].toDouble();
+
+			if (!results[r].met) {
+				status.message = "Timeout";
+			}
+			else if (errors[indices[r]].type() == EndpointValueType::INVALID) {
+				status.message = "Cannot read error";
+			}
+			else if (error != 0) {
+				std::stringstream message;
+				message << "Error 0x" << std::uppercase << std::hex << error;
+				status.message = message.str();
+			}
+			else {
+				status.success = true;
+				status.message = "Done";
+			}
+			LOG_INFO("Calibration of odrv{} axis{}: {} after {:.1f} s", status.odriveID, axis, status.message, status.elapsed);
+		}
+	}
+
+	isRunning = false;
+}
@@ -0,0 +1,201 @@
+
+#include "pch.h"
+#include "ScopeCapture.h"
+
+// Endpoints of the scope are optional depending on the firmware, so a missing one is no error
+static BasicEndpoint* FindOptional(ODrive& odrive, const std::string& identifier) {
+	auto it = odrive.endpointIndex.find(identifier);
+	return it != odrive.endpointIndex.end() ? &odrive.cachedEndpoints[it->second] : nullptr;
+}
+
+static std::string SourceName(int index) {
+	return "oscilloscope.config.source" + std::to_string(index);
+}
+
+bool ScopeCapture::Supported(ODrive& odrive) {
+	auto getVal = odrive.functions.find("oscilloscope.get_val");
+	return odrive.loaded && FindOptional(odrive, "oscilloscope.size") && getVal != odrive.functions.end() &&
+		getVal->second->inputs.size() == 1 && getVal->second->outputs.size() == 1;
+}
+
+bool ScopeCapture::Configurable(ODrive& odrive) {
+	if (!FindOptional(odrive, "oscilloscope.config.channels") || !FindOptional(odrive, "oscilloscope.config.decimation"))
+		return false;
+
+	for (int c = 0; c < SCOPE_MAX_CHANNELS; c++) {
+		if (!FindOptional(odrive, SourceName(c)))
+			return false;
+	}
+	return true;
+}
+
+bool ScopeCapture::Download(ODrive& odrive, size_t count, std::vector<float>& values, const std::atomic<bool>* abort) {
+
+	values.clear();
+	if (!Supported(odrive))
+		return false;
+
+	TransferPriorityScope priority(TransferPriority::BACKGROUND);
+	const Endpoint& getVal = *odrive.functions.at("oscilloscope.get_val");
+	const BasicEndpoint& index = getVal.inputs[0].basic;
+
+	// One batch is encoded per chunk size, the indices are patched in for every chunk. transact()
+	// keeps ODRIVE_PIPELINE_DEPTH reads in flight, the chunk only bounds what is encoded at once.
+	RequestBatch batch;
+	std::vector<std::pair<size_t, size_t>> calls;		// Index write, value read
+	auto build = [&](size_t chunk) {
+		batch.clear();
+		calls.clear();
+		for (size_t i = 0; i < chunk; i++) {
+			size_t write = batch.addWrite(index, EndpointValue((uint32_t)0).as(index.type));
+			batch.addCall(getVal.basic);
+			calls.emplace_back(write, batch.addRead(getVal.outputs[0].basic));
+		}
+	};
+
+	values.reserve(count);
+	for (size_t first = 0; first < count; first += SCOPE_DOWNLOAD_CHUNK) {
+		if (abort && *abort)
+			return false;
+
+		size_t chunk = std::min<size_t>(SCOPE_DOWNLOAD_CHUNK, count - first);
+		if (calls.size() != chunk) {
+			build(chunk);
+		}
+		for (size_t i = 0; i < chunk; i++) {
+			batch.setValue(calls[i].first, EndpointValue((uint32_t)(first + i)).as(index.type));
+		}
+
+		if (!odrive.transact(batch)) {
+			LOG_ERROR("odrv{}: The scope download failed at value {} of {}", odrive.odriveID, first, count);
+			return false;
+		}
+		for (auto& [write, read] : calls) {
+			values.push_back((float)batch.results[read].toDouble());
+		}
+	}
+	return true;
+}
+
+ScopeResult ScopeCapture::Run(std::shared_ptr<ODrive> device, const ScopeSettings& settings, const std::atomic<bool>* abort) {
+
+	TransferPriorityScope priority(TransferPriority::INTERACTIVE);
+	ODrive& odrive = *device;
+	ScopeResult result;
+	if (!Supported(odrive)) {
+		result.error = "The firmware has no oscilloscope";
+		return result;
+	}
+
+	// Configuration, if the firmware allows it. Sources are given to the device as endpoint ids.
+	size_t channels = 1;
+	uint32_t decimation = 1;
+	if (Configurable(odrive)) {
+		RequestBatch config;
+		if (!settings.sources.empty()) {
+			if (settings.sources.size() > SCOPE_MAX_CHANNELS) {
+				result.error = fmt::format("The scope records at most {} sources", SCOPE_MAX_CHANNELS);
+				return result;
+			}
+
+			auto count = FindOptional(odrive, "oscilloscope.config.channels");
+			config.addWrite(*count, EndpointValue((uint32_t)settings.sources.size()).as(count->type), true);
+			for (size_t c = 0; c < settings.sources.size(); c++) {
+				auto endpoint = FindOptional(odrive, settings.sources[c]);
+				if (!endpoint || EndpointValue(endpoint->type).type() == EndpointValueType::INVALID) {
+					result.error = settings.sources[c] + " can't be recorded, it is not a value";
+					return result;
+				}
+				auto source = FindOptional(odrive, SourceName((int)c));
+				config.addWrite(*source, EndpointValue((uint32_t)endpoint->id).as(source->type), true);
+			}
+		}
+		auto decimationEndpoint = FindOptional(odrive, "oscilloscope.config.decimation");
+		config.addWrite(*decimationEndpoint, EndpointValue(std::max(settings.decimation, 1u)).as(decimationEndpoint->type), true);
+		if (!odrive.transact(config)) {
+			result.error = "The scope could not be configured";
+			return result;
+		}
+
+		channels = std::clamp<size_t>((size_t)odrive.readValue(*FindOptional(odrive, "oscilloscope.config.channels")).toDouble(), 1, SCOPE_MAX_CHANNELS);
+		decimation = std::max<uint32_t>((uint32_t)odrive.readValue(*decimationEndpoint).toDouble(), 1);
+		for (size_t c = 0; c < channels; c++) {
+			uint16_t id = (uint16_t)odrive.readValue(*FindOptional(odrive, SourceName((int)c))).toDouble();
+			auto source = std::find_if(odrive.cachedEndpoints.begin(), odrive.cachedEndpoints.end(), [&](auto& ep) { return ep.id == id; });
+			result.channels.push_back(source != odrive.cachedEndpoints.end() ? source->identifier : fmt::format("source {}", id));
+		}
+	}
+	else {
+		if (!settings.sources.empty()) {
+			LOG_WARN("odrv{}: The scope sources are fixed in this firmware, recording those", odrive.odriveID);
+		}
+		result.channels.push_back("oscilloscope");
+	}
+
+	auto sampleRate = FindOptional(odrive, "oscilloscope.sample_rate");
+	double loopRate = sampleRate ? odrive.readValue(*sampleRate).toDouble() : SCOPE_DEFAULT_SAMPLE_RATE;
+	result.sampleRate = (loopRate > 0.0 ? loopRate : SCOPE_DEFAULT_SAMPLE_RATE) / decimation;
+
+	auto sizeEndpoint = FindOptional(odrive, "oscilloscope.size");
+	auto position = FindOptional(odrive, "oscilloscope.pos");
+	size_t size = (size_t)odrive.readValue(*sizeEndpoint).toDouble();
+	size_t full = size / channels * channels;
+	size_t count = position ? std::min((size_t)odrive.readValue(*position).toDouble(), full) : full;
+
+	// Trigger, the read right after it dates the first sample
+	double start = 0.0;
+	auto trigger = odrive.functions.find("oscilloscope.trigger");
+	if (settings.trigger && trigger != odrive.functions.end()) {
+		RequestBatch triggerBatch;
+		triggerBatch.addCall(trigger->second->basic);
+		size_t check = triggerBatch.addRead(position ? *position : *sizeEndpoint);
+		if (!odrive.transact(triggerBatch)) {
+			result.error = "The scope could not be triggered";
+			return result;
+		}
+		start = triggerBatch.times[check].sampled;
+
+		if (position) {
+			while ((count = (size_t)odrive.readValue(*position).toDouble()) < full) {
+				if (Battery::GetRuntime() > start + SCOPE_CAPTURE_TIMEOUT || (abort && *abort) || !odrive.connected) {
+					result.error = fmt::format("The scope buffer did not fill up, {} of {} values", count, full);
+					return result;
+				}
+				Battery::Sleep(SCOPE_POLL_INTERVAL);
+			}
+		}
+		else {		// No fill level, wait for as long as the buffer takes
+			Battery::Sleep(full / channels / result.sampleRate);
+			count = full;
+		}
+		result.captureTime = Battery::GetRuntime() - start;
+	}
+	else if (settings.trigger) {
+		LOG_WARN("odrv{}: The scope can't be triggered, downloading the buffer as it is", odrive.odriveID);
+	}
+
+	std::vector<float> values;
+	double downloadStart = Battery::GetRuntime();
+	if (!Download(odrive, count, values, abort)) {
+		result.error = "The scope buffer could not be downloaded";
+		return result;
+	}
+	result.downloadTime = Battery::GetRuntime() - downloadStart;
+	result.values = values.size();
+
+	// The channels are interleaved, one value of every channel per recorded cycle. Without a
+	// trigger the timestamps start at 0.
+	CaptureColumns& columns = result.columns;
+	columns.values.assign(channels, {});
+	size_t samples = values.size() / channels;
+	columns.timestamps.reserve(samples);
+	for (size_t k = 0; k < samples; k++) {
+		columns.timestamps.push_back(start + k / result.sampleRate);
+		for (size_t c = 0; c < channels; c++) {
+			columns.values[c].push_back(values[k * channels + c]);
+		}
+	}
+
+	result.success = true;
+	return result;
+}
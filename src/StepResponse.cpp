@@ -0,0 +1,221 @@
+
+#include "pch.h"
+#include "StepResponse.h"
+
+void StepResponse::Resample(const std::vector<double>& timestamps, const std::vector<double>& values,
+	const std::vector<double>& grid, std::vector<double>& resampled) {
+
+	resampled.resize(grid.size());
+	if (timestamps.empty()) {
+		std::fill(resampled.begin(), resampled.end(), NAN);
+		return;
+	}
+
+	// Both are sorted, so one pass with two indices does it
+	size_t i = 0;
+	for (size_t k = 0; k < grid.size(); k++) {
+		double t = grid[k];
+		while (i + 1 < timestamps.size() && timestamps[i + 1] < t) {
+			i++;
+		}
+		if (i + 1 >= timestamps.size() || t <= timestamps[i]) {
+			resampled[k] = (t <= timestamps[0]) ? values[0] : values.back();
+			continue;
+		}
+		double f = (t - timestamps[i]) / (timestamps[i + 1] - timestamps[i]);
+		resampled[k] = values[i] + (values[i + 1] - values[i]) * f;
+	}
+}
+
+StepMetrics StepResponse::Analyze(const std::vector<double>& time, const std::vector<double>& response, double amplitude) {
+
+	StepMetrics metrics;
+	size_t n = std::min(time.size(), response.size());
+	size_t start = std::lower_bound(time.begin(), time.begin() + n, 0.0) - time.begin();
+	if (n < 10 || start >= n)
+		return metrics;
+
+	// The loops below are branch-free and spread over STEP_METRIC_LANES independent lanes, so the
+	// compiler can put every lane into a SIMD register without reordering floating point math.
+	// A lane only ever sees every STEP_METRIC_LANES-th sample, the lanes are combined at the end.
+	const size_t L = STEP_METRIC_LANES;
+	const double* y = response.data();
+
+	// Final value is the mean of the last tenth
+	size_t tail = std::max<size_t>((n - start) / 10, 1);
+	size_t tailBody = n - tail + tail / L * L;
+	double sum[L] = {};
+	for (size_t k = n - tail; k < tailBody; k += L) {
+		for (size_t l = 0; l < L; l++) {
+			sum[l] += y[k + l];
+		}
+	}
+	for (size_t k = tailBody; k < n; k++) {
+		sum[0] += y[k];
+	}
+	double final = 0.0;
+	for (size_t l = 0; l < L; l++) {
+		final += sum[l];
+	}
+	final /= tail;
+	metrics.steadyStateError = amplitude - final;
+	if (final == 0.0)
+		return metrics;
+
+	// On the response normalized to the final value. The first 10% and 90% crossings are the
+	// minimum index at or above the level, the end of settling the maximum index outside the band.
+	double scale = 1.0 / final;
+	double none = (double)n;
+	double first10[L], first90[L], peak[L], lastOutside[L];
+	for (size_t l = 0; l < L; l++) {
+		first10[l] = none;
+		first90[l] = none;
+		peak[l] = -INFINITY;
+		lastOutside[l] = -1.0;
+	}
+	auto accumulate = [&first10, &first90, &peak, &lastOutside, scale, none](size_t l, double value, double index) {
+		double v = value * scale;
+		double rise10 = v >= 0.1 ? index : none;
+		double rise90 = v >= 0.9 ? index : none;
+		double outside = std::abs(v - 1.0) > STEP_SETTLING_BAND ? index : -1.0;
+		first10[l] = rise10 < first10[l] ? rise10 : first10[l];
+		first90[l] = rise90 < first90[l] ? rise90 : first90[l];
+		peak[l] = v > peak[l] ? v : peak[l];
+		lastOutside[l] = outside > lastOutside[l] ? outside : lastOutside[l];
+	};
+
+	size_t body = start + (n - start) / L * L;
+	double index[L];		// Of the current sample of every lane, as a double to stay in the same registers
+	for (size_t l = 0; l < L; l++) {
+		index[l] = (double)(start + l);
+	}
+	for (size_t k = start; k < body; k += L) {
+		for (size_t l = 0; l < L; l++) {
+			accumulate(l, y[k + l], index[l]);
+			index[l] += L;
+		}
+	}
+	for (size_t k = body; k < n; k++) {
+		accumulate(0, y[k], (double)k);
+	}
+	for (size_t l = 1; l < L; l++) {
+		first10[0] = std::min(first10[0], first10[l]);
+		first90[0] = std::min(first90[0], first90[l]);
+		peak[0] = std::max(peak[0], peak[l]);
+		lastOutside[0] = std::max(lastOutside[0], lastOutside[l]);
+	}
+
+	double t10 = first10[0] < none ? time[(size_t)first10[0]] : NAN;
+	double t90 = first90[0] < none ? time[(size_t)first90[0]] : NAN;
+	metrics.riseTime = t90 - t10;
+	metrics.overshoot = std::max(0.0, (peak[0] - 1.0) * 100.0);
+	if (lastOutside[0] < 0.0) {
+		metrics.settlingTime = 0.0;
+	}
+	else if ((size_t)lastOutside[0] + 1 < n) {
+		metrics.settlingTime = time[(size_t)lastOutside[0] + 1];
+	}
+	return metrics;
+}
+
+StepResult StepResponse::Run(std::shared_ptr<ODrive> device, const StepSettings& settings) {
+
+	TransferPriorityScope priority(TransferPriority::INTERACTIVE);
+	ODrive& odrive = *device;
+	StepResult result;
+	std::string axis = "axis" + std::to_string(settings.axis) + ".";
+	std::string input = axis + (settings.kind == StepKind::POSITION ? "controller.input_pos" : "controller.input_vel");
+	std::vector<std::string> channels = {
+		axis + (settings.kind == StepKind::POSITION ? "encoder.pos_estimate" : "encoder.vel_estimate"),
+		axis + "encoder.vel_estimate",
+		axis + "motor.current_control.Iq_measured"
+	};
+
+	if (!odrive.inClosedLoopControl(settings.axis)) {
+		result.error = "The axis is not in closed loop control";
+		return result;
+	}
+
+	float inputStart = 0.f;
+	ChannelCapture capture(device, channels);
+	if (!capture.valid() || !odrive.read<float>(input, &inputStart)) {
+		result.error = "The axis can't be captured";
+		return result;
+	}
+
+	for (double t = -STEP_BASELINE_TIME; t < settings.duration; t += STEP_RESAMPLE_PERIOD) {
+		result.time.push_back(t);
+	}
+	size_t baselineEnd = std::lower_bound(result.time.begin(), result.time.end(), 0.0) - result.time.begin();
+
+	std::vector<std::vector<double>> velocityRuns;
+	std::vector<std::vector<double>> currentRuns;
+	size_t samples = 0;
+	double captureTime = 0.0;
+	int repeats = std::clamp(settings.repeats, 1, STEP_MAX_REPEATS);
+
+	for (int run = 0; run < repeats; run++) {
+		CaptureColumns columns;
+		bool success = capture.run(STEP_BASELINE_TIME, 0, columns);
+		double stepTime = Battery::GetRuntime();
+		success = success && odrive.write<float>(input, inputStart + (float)settings.amplitude);
+		success = success && capture.run(settings.duration, 0, columns);
+		odrive.write<float>(input, inputStart);
+		if (!success || columns.size() < 2) {
+			result.error = "The device stopped answering";
+			return result;
+		}
+
+		for (double& timestamp : columns.timestamps) {
+			timestamp -= stepTime;
+		}
+		samples += columns.size();
+		captureTime += columns.timestamps.back() - columns.timestamps.front();
+
+		std::vector<double> response, velocity, current;
+		Resample(columns.timestamps, columns.values[0], result.time, response);
+		Resample(columns.timestamps, columns.values[1], result.time, velocity);
+		Resample(columns.timestamps, columns.values[2], result.time, current);
+
+		// The response is relative to where it was before the step
+		double initial = 0.0;
+		for (size_t k = 0; k < baselineEnd; k++) {
+			initial += response[k];
+		}
+		initial = baselineEnd > 0 ? initial / baselineEnd : response[0];
+		for (double& value : response) {
+			value -= initial;
+		}
+
+		result.runs.push_back(std::move(response));
+		velocityRuns.push_back(std::move(velocity));
+		currentRuns.push_back(std::move(current));
+
+		if (run + 1 < repeats) {		// Keep watching the axis while it returns, the samples are not needed
+			CaptureColumns rest;
+			capture.run(settings.rest, STEP_REST_RATE, rest);
+		}
+	}
+
+	auto average = [&](const std::vector<std::vector<double>>& runs, std::vector<double>& mean) {
+		mean.assign(result.time.size(), 0.0);
+		for (auto& run : runs) {
+			for (size_t k = 0; k < mean.size(); k++) {
+				mean[k] += run[k];
+			}
+		}
+		for (double& value : mean) {
+			value /= runs.size();
+		}
+	};
+	average(result.runs, result.response);
+	average(velocityRuns, result.velocity);
+	average(currentRuns, result.current);
+
+	result.metrics = Analyze(result.time, result.response, settings.amplitude);
+	result.rate = captureTime > 0.0 ? samples / captureTime : 0.0;
+	result.success = true;
+	LOG_INFO("Step response of odrv{} {}: rise {:.1f} ms, overshoot {:.1f}%, settling {:.1f} ms, {} runs at {:.0f} Hz",
+		odrive.odriveID, input, result.metrics.riseTime * 1000.0, result.metrics.overshoot, result.metrics.settlingTime * 1000.0, repeats, result.rate);
+	return result;
+}
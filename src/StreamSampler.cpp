@@ -0,0 +1,168 @@
+
+#include "pch.h"
+#include "StreamSampler.h"
+
+size_t StreamSampler::Stream::poll(std::vector<StreamSample>& samples) {
+	size_t count = 0;
+	StreamSample sample;
+	while (buffer.pop(sample)) {
+		samples.push_back(sample);
+		count++;
+	}
+	return count;
+}
+
+StreamSampler::~StreamSampler() {
+	stop();
+}
+
+bool StreamSampler::start(const std::vector<Channel>& channels, double rate) {
+
+	if (isRunning)
+		return false;
+
+	activeStreams.clear();
+	std::map<int, Stream*> streamsByDevice;
+	for (const Channel& channel : channels) {
+		auto odrive = registry.get(channel.odriveID);
+		if (!odrive)
+			continue;
+
+		auto endpoint = odrive->findEndpoint(channel.identifier);
+		if (!endpoint || endpoint->type == "function")
+			continue;
+
+		Stream*& stream = streamsByDevice[channel.odriveID];
+		if (!stream) {
+			activeStreams.push_back(std::make_unique<Stream>(channel.odriveID));
+			stream = activeStreams.back().get();
+		}
+
+		if (stream->identifiers.size() >= STREAM_MAX_CHANNELS) {
+			LOG_WARN("odrv{}: Only {} channels can be streamed, ignoring {}", channel.odriveID, STREAM_MAX_CHANNELS, channel.identifier);
+			continue;
+		}
+
+		stream->identifiers.push_back(channel.identifier);
+		stream->batch.addRead(*endpoint);		// Encoded once here, the loop only sends it
+	}
+
+	if (activeStreams.empty())
+		return false;
+
+	isRunning = true;
+	for (auto& stream : activeStreams) {
+		stream->thread = std::thread([this, stream = stream.get(), odrive = registry.get(stream->odriveID), rate] {
+			sampleLoop(*stream, odrive, rate);
+		});
+	}
+
+	size_t accepted = 0;
+	for (auto& stream : activeStreams) {
+		accepted += stream->identifiers.size();
+	}
+	LOG_INFO("Streaming {} of {} channels from {} devices at {} Hz", accepted, channels.size(), activeStreams.size(), rate);
+	return true;
+}
+
+void StreamSampler::stop() {
+
+	if (!isRunning)
+		return;
+
+	isRunning = false;
+	for (auto& stream : activeStreams) {
+		if (stream->thread.joinable()) {
+			stream->thread.join();
+		}
+	}
+
+	for (auto& stream : activeStreams) {
+		Stats stats = stream->stats();
+		LOG_INFO("odrv{}: Streamed {} samples, {} dropped, {} failed", stream->odriveID, stats.samples, stats.dropped, stats.failed);
+	}
+}
+
+void StreamSampler::sampleLoop(Stream& stream, std::shared_ptr<ODrive> odrive, double rate) {
+
+	TransferPriorityScope priority(TransferPriority::POLL);
+	using clock = std::chrono::steady_clock;
+	auto period = std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(rate > 0 ? 1.0 / rate : 0.0));
+	auto nextSample = clock::now();
+
+	Stats stats;
+	double windowStart = Battery::GetRuntime();
+	double lastTimestamp = 0.0;
+	size_t windowSamples = 0;
+	double intervalSum = 0.0;
+	double intervalSquareSum = 0.0;
+	double maxJitter = 0.0;
+
+	while (isRunning) {
+
+		// The schedule is absolute, so a late sample does not shift all following ones. If we fell
+		// behind by more than a period, skip ahead instead of bursting to catch up.
+		if (rate > 0) {
+			nextSample += period;
+			auto now = clock::now();
+			if (nextSample < now - period) {
+				nextSample = now;
+			}
+			std::this_thread::sleep_until(nextSample);
+		}
+
+		StreamSample sample;
+		bool success = odrive->transact(stream.batch);
+		if (!success) {
+			stats.failed++;
+			if (!odrive->connected)
+				break;
+			continue;
+		}
+
+		sample.time = stream.batch.sampleTime();
+		for (size_t i = 0; i < stream.batch.results.size(); i++) {
+			sample.values[i] = stream.batch.results[i].toDouble();
+		}
+
+		if (stream.buffer.push(sample)) {
+			stats.samples++;
+		}
+		else {
+			stats.dropped++;
+		}
+
+		// Interval statistics
+		if (lastTimestamp > 0.0) {
+			double interval = sample.time.sampled - lastTimestamp;
+			intervalSum += interval;
+			intervalSquareSum += interval * interval;
+			windowSamples++;
+			if (rate > 0) {
+				maxJitter = std::max(maxJitter, std::abs(interval - 1.0 / rate));
+			}
+		}
+		lastTimestamp = sample.time.sampled;
+
+		if (sample.time.sampled - windowStart >= STREAM_STATS_INTERVAL && windowSamples > 0) {
+			double mean = intervalSum / windowSamples;
+			stats.rate = windowSamples / (sample.time.sampled - windowStart);
+			stats.jitter = std::sqrt(std::max(intervalSquareSum / windowSamples - mean * mean, 0.0));
+			stats.maxJitter = maxJitter;
+			{
+				std::lock_guard<std::mutex> lock(stream.statsMutex);
+				stream.currentStats = stats;
+			}
+			windowStart = sample.time.sampled;
+			windowSamples = 0;
+			intervalSum = 0.0;
+			intervalSquareSum = 0.0;
+			maxJitter = 0.0;
+		}
+	}
+
+	std::lock_guard<std::mutex> lock(stream.statsMutex);
+	stream.currentStats.samples = stats.samples;
+	stream.currentStats.dropped = stats.dropped;
+	stream.currentStats.failed = stats.failed;
+}
@@ -0,0 +1,212 @@
+
+#include "pch.h"
+#include "SweepRunner.h"
+#include "ConfigTransaction.h"
+
+ChannelMetrics ChannelMetrics::Compute(const std::vector<double>& samples) {
+
+	ChannelMetrics metrics;
+	if (samples.empty())
+		return metrics;
+
+	// A floating point sum can't be vectorized as written, that would reorder the additions. With
+	// METRIC_LANES independent accumulators the order is fixed and every lane maps onto SIMD.
+	const double* x = samples.data();
+	size_t n = samples.size();
+	size_t body = n - n % METRIC_LANES;
+
+	double sum[METRIC_LANES] = {};
+	double minimum[METRIC_LANES];
+	double maximum[METRIC_LANES];
+	std::fill(std::begin(minimum), std::end(minimum), x[0]);
+	std::fill(std::begin(maximum), std::end(maximum), x[0]);
+	for (size_t k = 0; k < body; k += METRIC_LANES) {
+		for (size_t l = 0; l < METRIC_LANES; l++) {
+			double value = x[k + l];		// Selects on values instead of std::min, which returns a reference and branches
+			sum[l] += value;
+			minimum[l] = value < minimum[l] ? value : minimum[l];
+			maximum[l] = value > maximum[l] ? value : maximum[l];
+		}
+	}
+	for (size_t k = body; k < n; k++) {
+		sum[0] += x[k];
+		minimum[0] = std::min(minimum[0], x[k]);
+		maximum[0] = std::max(maximum[0], x[k]);
+	}
+	for (size_t l = 1; l < METRIC_LANES; l++) {
+		sum[0] += sum[l];
+		minimum[0] = std::min(minimum[0], minimum[l]);
+		maximum[0] = std::max(maximum[0], maximum[l]);
+	}
+	metrics.mean = sum[0] / n;
+	metrics.peakToPeak = maximum[0] - minimum[0];
+
+	double squares[METRIC_LANES] = {};
+	for (size_t k = 0; k < body; k += METRIC_LANES) {
+		for (size_t l = 0; l < METRIC_LANES; l++) {
+			double d = x[k + l] - metrics.mean;
+			squares[l] += d * d;
+		}
+	}
+	for (size_t k = body; k < n; k++) {
+		double d = x[k] - metrics.mean;
+		squares[0] += d * d;
+	}
+	for (size_t l = 1; l < METRIC_LANES; l++) {
+		squares[0] += squares[l];
+	}
+	metrics.deviation = std::sqrt(squares[0] / n);
+	return metrics;
+}
+
+SweepRunner::~SweepRunner() {
+	stop();
+}
+
+bool SweepRunner::start(const SweepSettings& settings) {
+
+	if (running())
+		return false;
+
+	for (auto& thread : threads) {		// Finished sweeps
+		thread.join();
+	}
+	threads.clear();
+
+	auto stepsValid = [](const SweepParameter& p) { return p.steps >= 1 && p.steps <= SWEEP_MAX_STEPS; };
+	if (settings.odriveIDs.empty() || settings.channels.empty() || !stepsValid(settings.first) ||
+		(settings.second && !stepsValid(*settings.second))) {
+		LOG_ERROR("Sweep not started: It needs drives, channels and 1 to {} steps per parameter", SWEEP_MAX_STEPS);
+		return false;
+	}
+
+	currentSettings = settings;
+	abort = false;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		devices.clear();
+		for (int id : settings.odriveIDs) {
+			DeviceSweep device;
+			device.odriveID = id;
+			devices.push_back(device);
+		}
+	}
+
+	active = settings.odriveIDs.size();
+	for (size_t i = 0; i < settings.odriveIDs.size(); i++) {
+		threads.emplace_back([this, i] {
+			sweep(i);
+			active--;
+		});
+	}
+
+	LOG_INFO("Sweeping {} points on {} drives", totalPoints(), settings.odriveIDs.size());
+	return true;
+}
+
+void SweepRunner::stop() {
+	abort = true;
+	for (auto& thread : threads) {
+		thread.join();
+	}
+	threads.clear();
+}
+
+size_t SweepRunner::totalPoints() const {
+	return (size_t)currentSettings.first.steps * (currentSettings.second ? currentSettings.second->steps : 1);
+}
+
+std::vector<SweepRunner::DeviceSweep> SweepRunner::results() const {
+	std::lock_guard<std::mutex> lock(mutex);
+	return devices;
+}
+
+void SweepRunner::fail(size_t index, const std::string& error) {
+	std::lock_guard<std::mutex> lock(mutex);
+	devices[index].error = error;
+	LOG_ERROR("Sweep on odrv{} failed: {}", devices[index].odriveID, error);
+}
+
+void SweepRunner::sweep(size_t index) {
+
+	TransferPriorityScope priority(TransferPriority::POLL);
+	const SweepSettings& settings = currentSettings;
+	auto odrive = registry.get(settings.odriveIDs[index]);
+	if (!odrive || !*odrive) {
+		fail(index, "Not connected");
+		return;
+	}
+
+	ChannelCapture capture(odrive, settings.channels);
+	if (!capture.valid()) {
+		fail(index, "Invalid channels");
+		return;
+	}
+
+	// Remember what to restore afterwards
+	std::vector<const SweepParameter*> parameters = { &settings.first };
+	if (settings.second) {
+		parameters.push_back(&*settings.second);
+	}
+	ConfigTransaction original;
+	std::vector<const BasicEndpoint*> endpoints;
+	for (auto* parameter : parameters) {
+		auto endpoint = odrive->findEndpoint(parameter->identifier);
+		if (!endpoint) {
+			fail(index, parameter->identifier + " does not exist");
+			return;
+		}
+		EndpointValue value = odrive->readValue(*endpoint);
+		if (value.type() == EndpointValueType::INVALID) {		// Nothing is applied yet that would need restoring
+			fail(index, "Cannot read the original value of " + parameter->identifier);
+			return;
+		}
+		original.set(parameter->identifier, value);
+		endpoints.push_back(endpoint);
+	}
+
+	CaptureColumns columns;
+	int secondSteps = settings.second ? settings.second->steps : 1;
+	for (int i = 0; i < settings.first.steps && !abort; i++) {
+		for (int j = 0; j < secondSteps && !abort; j++) {
+
+			SweepPoint point;
+			point.firstStep = i;
+			point.secondStep = j;
+
+			// In the type of the parameter, integer parameters are rounded
+			ConfigTransaction transaction;
+			EndpointValue first(endpoints[0]->type);
+			first.fromDouble(settings.first.value(i));
+			transaction.set(settings.first.identifier, first);
+			if (settings.second) {
+				EndpointValue second(endpoints[1]->type);
+				second.fromDouble(settings.second->value(j));
+				transaction.set(settings.second->identifier, second);
+			}
+
+			if (transaction.commit(*odrive).success) {
+				double settled = Battery::GetRuntime() + settings.settleTime;
+				while (Battery::GetRuntime() < settled && !abort) {
+					Battery::Sleep(0.01);
+				}
+
+				columns.clear();
+				if (capture.run(settings.captureTime, settings.rate, columns, &abort) && !abort && columns.size() > 1) {
+					for (auto& column : columns.values) {
+						point.metrics.push_back(ChannelMetrics::Compute(column));
+					}
+					point.rate = (columns.size() - 1) / (columns.timestamps.back() - columns.timestamps.front());
+					point.success = true;
+				}
+			}
+
+			std::lock_guard<std::mutex> lock(mutex);
+			devices[index].points.push_back(std::move(point));
+		}
+	}
+
+	if (!original.commit(*odrive).success) {
+		fail(index, "The original values could not be restored");
+	}
+}
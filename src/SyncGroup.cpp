@@ -0,0 +1,194 @@
+
+#include "pch.h"
+#include "SyncGroup.h"
+
+SyncGroup::SyncGroup(const DeviceRegistry& registry, const std::vector<int>& odriveIDs, const std::vector<std::string>& identifiers, bool write)
+	: odriveIDs(odriveIDs), identifiers(identifiers), writes(write) {
+
+	if (odriveIDs.empty() || identifiers.empty())
+		return;
+
+	for (int odriveID : odriveIDs) {
+		auto worker = std::make_unique<Worker>();
+		worker->odrive = registry.get(odriveID);
+		if (!worker->odrive) {
+			LOG_ERROR("Synchronized group: odrv{} is not connected", odriveID);
+			return;
+		}
+
+		for (auto& identifier : identifiers) {
+			auto endpoint = worker->odrive->findEndpoint(identifier);
+			bool usable = endpoint && (write ? (!endpoint->readonly && endpoint->type == "float")
+											 : EndpointValue(endpoint->type).type() != EndpointValueType::INVALID);
+			if (!usable) {
+				LOG_ERROR("Synchronized group: odrv{}.{} can't be {}", odriveID, identifier, write ? "written" : "read");
+				return;
+			}
+			write ? worker->batch.addWrite(*endpoint, EndpointValue(0.f)) : worker->batch.addRead(*endpoint);
+		}
+		workers.push_back(std::move(worker));
+	}
+
+	for (auto& worker : workers) {
+		worker->thread = std::thread(&SyncGroup::workerLoop, this, std::ref(*worker));
+	}
+	isValid = true;
+}
+
+SyncGroup::~SyncGroup() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		quit = true;
+	}
+	wake.notify_all();
+	for (auto& worker : workers) {
+		if (worker->thread.joinable()) {
+			worker->thread.join();
+		}
+	}
+}
+
+bool SyncGroup::read(SyncSample& sample) {
+	if (!isValid || writes)
+		return false;
+
+	auto lead = std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(SYNC_WAKE_LEAD));
+	return transact(clock::now() + lead, sample);
+}
+
+bool SyncGroup::write(const std::vector<std::vector<float>>& values, SyncSample& sample) {
+	if (!isValid || !writes || values.size() != workers.size())
+		return false;
+
+	for (size_t i = 0; i < workers.size(); i++) {
+		if (values[i].size() != identifiers.size())
+			return false;
+		for (size_t j = 0; j < identifiers.size(); j++) {
+			workers[i]->batch.setValue(j, EndpointValue(values[i][j]));
+		}
+	}
+
+	auto lead = std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(SYNC_WAKE_LEAD));
+	return transact(clock::now() + lead, sample);
+}
+
+bool SyncGroup::run(double duration, double rate, std::vector<SyncSample>& samples, const std::atomic<bool>* abort) {
+
+	if (!isValid || writes)
+		return false;
+
+	samples.reserve(samples.size() + (size_t)(duration * (rate > 0 ? rate : 1000.0)));
+	auto lead = std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(SYNC_WAKE_LEAD));
+	auto period = std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(rate > 0 ? 1.0 / rate : 0.0));
+	auto nextSample = clock::now() + lead;
+	double end = Battery::GetRuntime() + duration;
+
+	while (Battery::GetRuntime() < end && !(abort && *abort)) {
+
+		// Absolute schedule, same as the StreamSampler. The workers are told the send time
+		// ahead, so they are already awake when it comes.
+		auto now = clock::now();
+		if (nextSample < now) {
+			nextSample = now + lead;
+		}
+		std::this_thread::sleep_until(nextSample - lead);
+
+		SyncSample sample;
+		transact(nextSample, sample);
+		samples.push_back(std::move(sample));
+		nextSample += period;
+
+		for (auto& worker : workers) {
+			if (!worker->odrive->connected)
+				return false;
+		}
+	}
+	return true;
+}
+
+SyncGroup::Stats SyncGroup::stats() const {
+	std::lock_guard<std::mutex> lock(statsMutex);
+	return currentStats;
+}
+
+bool SyncGroup::transact(clock::time_point sendTime, SyncSample& sample) {
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		scheduled = sendTime;
+		finished = 0;
+		generation++;
+	}
+	wake.notify_all();
+
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		done.wait(lock, [&] { return finished == workers.size(); });
+	}
+
+	sample.success = true;
+	sample.times.resize(workers.size());
+	sample.values.assign(writes ? 0 : workers.size(), {});
+	double firstSent = INFINITY, lastSent = -INFINITY;
+	double firstEstimate = INFINITY, lastEstimate = -INFINITY;
+	for (size_t i = 0; i < workers.size(); i++) {
+		Worker& worker = *workers[i];
+		sample.success &= worker.success;
+		sample.times[i] = worker.batch.sampleTime();
+		firstSent = std::min(firstSent, sample.times[i].sent);
+		lastSent = std::max(lastSent, sample.times[i].sent);
+		firstEstimate = std::min(firstEstimate, sample.times[i].sampled);
+		lastEstimate = std::max(lastEstimate, sample.times[i].sampled);
+		if (!writes) {
+			for (auto& result : worker.batch.results) {
+				sample.values[i].push_back(result.toDouble());
+			}
+		}
+	}
+	sample.sendSkew = lastSent - firstSent;
+	sample.skew = lastEstimate - firstEstimate;
+
+	std::lock_guard<std::mutex> lock(statsMutex);
+	if (!sample.success) {
+		currentStats.failed++;
+		return false;
+	}
+	skews.record(sample.skew);
+	skewSum += sample.skew;
+	sendSkewSum += sample.sendSkew;
+	currentStats.samples++;
+	currentStats.meanSkew = skewSum / currentStats.samples;
+	currentStats.maxSkew = std::max(currentStats.maxSkew, sample.skew);
+	currentStats.meanSendSkew = sendSkewSum / currentStats.samples;
+	currentStats.maxSendSkew = std::max(currentStats.maxSendSkew, sample.sendSkew);
+	return true;
+}
+
+void SyncGroup::workerLoop(Worker& worker) {
+
+	TransferPriorityScope priority(TransferPriority::INTERACTIVE);
+	auto spin = std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(SYNC_SPIN_TIME));
+	uint64_t handled = 0;
+
+	while (true) {
+		clock::time_point sendTime;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			wake.wait(lock, [&] { return quit || generation != handled; });
+			if (quit)
+				return;
+			handled = generation;
+			sendTime = scheduled;
+		}
+
+		std::this_thread::sleep_until(sendTime - spin);
+		while (clock::now() < sendTime);
+		worker.success = worker.odrive->transact(worker.batch);
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			finished++;
+		}
+		done.notify_one();
+	}
+}
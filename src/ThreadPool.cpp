@@ -0,0 +1,129 @@
+
+#include "pch.h"
+#include "ThreadPool.h"
+
+static thread_local ThreadPool* currentPool = nullptr;
+static thread_local size_t currentWorker = 0;
+
+ThreadPool::ThreadPool(const std::string& name, size_t threadCount) : name(name) {
+	threadCount = std::max<size_t>(threadCount, 1);
+	for (size_t i = 0; i < threadCount; i++) {
+		workers.push_back(std::make_unique<Worker>());
+	}
+	for (size_t i = 0; i < threadCount; i++) {
+		workers[i]->thread = std::thread(std::bind(&ThreadPool::workerThread, this, i));
+	}
+	LOG_DEBUG("Started thread pool '{}' with {} threads", name, threadCount);
+}
+
+ThreadPool::~ThreadPool() {
+	stop();
+}
+
+void ThreadPool::stop() {
+	{
+		std::lock_guard<std::mutex> lock(sleepMutex);
+		if (stopping)
+			return;
+		stopping = true;
+	}
+	wakeup.notify_all();
+
+	for (auto& worker : workers) {
+		worker->thread.join();
+	}
+
+	Stats s = stats();
+	LOG_DEBUG("Thread pool '{}' stopped: {} tasks executed, {} stolen", name, s.executed, s.stolen);
+}
+
+void ThreadPool::submit(std::function<void()> task) {
+
+	size_t index = 0;
+	if (currentPool == this) {
+		index = currentWorker;		// Keep work spawned by a task local, others may steal it
+	}
+	else {
+		index = nextWorker.fetch_add(1) % workers.size();
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(sleepMutex);	// Pairs with the predicate check of a sleeping worker
+		pending++;		// Counted before it is queued, so it can never be taken before it was counted
+	}
+	{
+		std::lock_guard<std::mutex> lock(workers[index]->mutex);
+		workers[index]->tasks.push_back(std::move(task));
+	}
+	submitted++;
+	wakeup.notify_one();
+}
+
+ThreadPool::Stats ThreadPool::stats() const {
+	Stats s;
+	s.threads = workers.size();
+	s.queued = pending;
+	s.submitted = submitted;
+	for (auto& worker : workers) {
+		s.executed += worker->executed;
+		s.stolen += worker->stolen;
+	}
+	return s;
+}
+
+bool ThreadPool::takeTask(size_t index, std::function<void()>& task) {
+
+	// Own queue first, newest task
+	{
+		Worker& own = *workers[index];
+		std::lock_guard<std::mutex> lock(own.mutex);
+		if (!own.tasks.empty()) {
+			task = std::move(own.tasks.back());
+			own.tasks.pop_back();
+			return true;
+		}
+	}
+
+	// Steal the oldest task of someone else
+	for (size_t i = 1; i < workers.size(); i++) {
+		Worker& victim = *workers[(index + i) % workers.size()];
+		std::lock_guard<std::mutex> lock(victim.mutex);
+		if (!victim.tasks.empty()) {
+			task = std::move(victim.tasks.front());
+			victim.tasks.pop_front();
+			workers[index]->stolen++;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void ThreadPool::workerThread(size_t index) {
+	currentPool = this;
+	currentWorker = index;
+
+	while (true) {
+		{
+			std::unique_lock<std::mutex> lock(sleepMutex);
+			wakeup.wait(lock, [&] { return pending > 0 || stopping; });
+			if (stopping && pending == 0)
+				return;
+		}
+
+		std::function<void()> task;
+		if (!takeTask(index, task)) {
+			std::this_thread::yield();	// Someone else was faster, or the task is not queued yet
+			continue;
+		}
+
+		pending--;
+		try {
+			task();
+		}
+		catch (const std::exception& e) {
+			LOG_ERROR("Uncaught exception in thread pool '{}': {}", name, e.what());
+		}
+		workers[index]->executed++;
+	}
+}
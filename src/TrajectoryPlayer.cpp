@@ -0,0 +1,257 @@
+
+#include "pch.h"
+#include "TrajectoryPlayer.h"
+#include "MappedFile.h"
+
+#include <charconv>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+std::optional<Trajectory> Trajectory::Load(const std::string& path, std::string& error) {
+
+	MappedFile file(path);
+	if (!file.valid()) {
+		error = "Cannot open " + path;
+		return std::nullopt;
+	}
+
+	Trajectory trajectory;
+	const char* position = file.data();
+	const char* end = file.data() + file.size();
+	auto lineEnd = [&](const char* from) {
+		const char* newline = (const char*)memchr(from, '\n', end - from);
+		return newline ? newline : end;
+	};
+
+	// Header: time, then odrvN.identifier per column
+	const char* headerEnd = lineEnd(position);
+	std::stringstream header(std::string(position, headerEnd));
+	std::string column;
+	std::getline(header, column, ',');
+	while (std::getline(header, column, ',')) {
+		column.erase(column.find_last_not_of(" \t\r") + 1);
+		column.erase(0, column.find_first_not_of(" \t"));
+		size_t dot = column.find('.');
+		Target target;
+		if (column.rfind("odrv", 0) != 0 || dot == std::string::npos ||
+			std::from_chars(column.data() + 4, column.data() + dot, target.odriveID).ec != std::errc()) {
+			error = "Column '" + column + "' is not odrvN.identifier";
+			return std::nullopt;
+		}
+		target.identifier = column.substr(dot + 1);
+		trajectory.targets.push_back(target);
+	}
+	if (trajectory.targets.empty()) {
+		error = "The file has no setpoint columns";
+		return std::nullopt;
+	}
+	trajectory.values.resize(trajectory.targets.size());
+	position = headerEnd;
+
+	// Values, parsed straight from the mapping
+	size_t line = 1;
+	while (position < end) {
+		const char* next = lineEnd(position + 1);
+		line++;
+		const char* p = position + (*position == '\n' ? 1 : 0);
+		while (p < next && (*p == ' ' || *p == '\r')) p++;
+		if (p >= next) {		// Empty line
+			position = next;
+			continue;
+		}
+
+		double time = 0.0;
+		auto result = std::from_chars(p, next, time);
+		bool valid = result.ec == std::errc();
+		p = result.ptr;
+		for (size_t i = 0; valid && i < trajectory.targets.size(); i++) {
+			while (p < next && (*p == ',' || *p == ' ')) p++;
+			float value = 0.f;
+			result = std::from_chars(p, next, value);
+			valid = result.ec == std::errc();
+			p = result.ptr;
+			trajectory.values[i].push_back(value);
+		}
+
+		if (!valid || (!trajectory.times.empty() && time < trajectory.times.back())) {
+			error = fmt::format("Line {} is invalid or goes back in time", line);
+			return std::nullopt;
+		}
+		trajectory.times.push_back(time);
+		position = next;
+	}
+
+	if (trajectory.times.empty()) {
+		error = "The file has no setpoints";
+		return std::nullopt;
+	}
+	return trajectory;
+}
+
+TrajectoryPlayer::~TrajectoryPlayer() {
+	stop();
+}
+
+bool TrajectoryPlayer::start(std::shared_ptr<const Trajectory> trajectory, const Options& options, std::string& error) {
+
+	if (isRunning || !trajectory)
+		return false;
+
+	std::vector<DeviceStream> devices;
+	for (size_t i = 0; i < trajectory->targets.size(); i++) {
+		auto& target = trajectory->targets[i];
+		auto odrive = registry.get(target.odriveID);
+		if (!odrive || !*odrive) {
+			error = fmt::format("odrv{} is not connected", target.odriveID);
+			return false;
+		}
+		auto endpoint = odrive->findEndpoint(target.identifier);
+		if (!endpoint || endpoint->readonly || endpoint->type != "float") {
+			error = fmt::format("odrv{}.{} is not a writable float", target.odriveID, target.identifier);
+			return false;
+		}
+
+		auto device = std::find_if(devices.begin(), devices.end(), [&](auto& d) { return d.odrive == odrive; });
+		if (device == devices.end()) {
+			devices.push_back({ odrive });
+			device = devices.end() - 1;
+		}
+		device->columns.emplace_back(i, device->batch.addWrite(*endpoint, EndpointValue(0.f)));
+	}
+
+	if (thread.joinable()) {		// Finished on its own
+		thread.join();
+	}
+
+	jitterHistogram = std::make_unique<LatencyHistogram>();
+	{
+		std::lock_guard<std::mutex> lock(statsMutex);
+		currentStats = Stats();
+		currentStats.total = trajectory->times.size();
+	}
+
+	isRunning = true;
+	thread = std::thread([this, trajectory, devices = std::move(devices), options]() mutable {
+		playLoop(trajectory, std::move(devices), options);
+		isRunning = false;
+	});
+	return true;
+}
+
+void TrajectoryPlayer::stop() {
+	isRunning = false;
+	if (thread.joinable()) {
+		thread.join();
+	}
+}
+
+TrajectoryPlayer::Stats TrajectoryPlayer::stats() const {
+	std::lock_guard<std::mutex> lock(statsMutex);
+	return currentStats;
+}
+
+void TrajectoryPlayer::ConfigureThread(const Options& options) {
+#ifdef __linux__
+	if (options.realtime) {
+		sched_param parameter = {};
+		parameter.sched_priority = PLAYER_REALTIME_PRIORITY;
+		if (pthread_setschedparam(pthread_self(), SCHED_FIFO, &parameter) != 0) {
+			LOG_WARN("Trajectory player: SCHED_FIFO is not permitted, playing with normal priority");
+		}
+	}
+	if (options.cpu >= 0) {
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		CPU_SET(options.cpu, &set);
+		if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0) {
+			LOG_WARN("Trajectory player: Cannot pin the thread to CPU {}", options.cpu);
+		}
+	}
+#elif defined(_WIN32)
+	if (options.realtime) {
+		SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_TIME_CRITICAL);
+	}
+	if (options.cpu >= 0) {
+		SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)1 << options.cpu);
+	}
+#endif
+}
+
+void TrajectoryPlayer::playLoop(std::shared_ptr<const Trajectory> trajectory, std::vector<DeviceStream> devices, Options options) {
+
+	ConfigureThread(options);
+	TransferPriorityScope priority(TransferPriority::INTERACTIVE);
+
+	// The schedule runs on the steady clock, the send times of the batches are runtimes
+	using clock = std::chrono::steady_clock;
+	auto spin = std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(PLAYER_SPIN_TIME));
+	auto start = clock::now() + std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(PLAYER_START_DELAY));
+	double runtimeStart = Battery::GetRuntime() + PLAYER_START_DELAY;
+	double firstTime = trajectory->times.front();
+	double jitterSum = 0.0;
+	std::vector<double> deviceJitterSums(devices.size(), 0.0);
+	size_t writes = 0;
+	Stats stats;
+	stats.total = trajectory->times.size();
+	for (auto& device : devices) {
+		stats.devices.push_back({ device.odrive->odriveID });
+	}
+
+	for (size_t k = 0; k < trajectory->times.size() && isRunning; k++) {
+
+		// Sleep most of the way, then spin for the exact moment
+		auto scheduled = start + std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(trajectory->times[k] - firstTime));
+		std::this_thread::sleep_until(scheduled - spin);
+		while (clock::now() < scheduled);
+
+		double scheduledRuntime = runtimeStart + (trajectory->times[k] - firstTime);
+		for (size_t d = 0; d < devices.size(); d++) {
+			DeviceStream& device = devices[d];
+			DeviceStats& deviceStats = stats.devices[d];
+			for (auto& [column, request] : device.columns) {
+				device.batch.setValue(request, EndpointValue(trajectory->values[column][k]));
+			}
+			if (!device.odrive->transact(device.batch)) {
+				stats.failed++;
+				deviceStats.failed++;
+				continue;
+			}
+
+			// The two clocks were read a moment apart, a write can seem a little early
+			double jitter = std::max(device.batch.sent - scheduledRuntime, 0.0);
+			bool late = jitter > PLAYER_LATE_THRESHOLD;
+			jitterHistogram->record(jitter);
+			jitterSum += jitter;
+			deviceJitterSums[d] += jitter;
+			writes++;
+			stats.late += late ? 1 : 0;
+			stats.maxJitter = std::max(stats.maxJitter, jitter);
+			stats.meanJitter = jitterSum / writes;
+			deviceStats.late += late ? 1 : 0;
+			deviceStats.maxJitter = std::max(deviceStats.maxJitter, jitter);
+			deviceStats.meanJitter = deviceJitterSums[d] / (k + 1 - deviceStats.failed);
+		}
+		stats.sent++;
+
+		if (k % 64 == 0 || k + 1 == trajectory->times.size()) {
+			std::lock_guard<std::mutex> lock(statsMutex);
+			currentStats = stats;
+		}
+	}
+
+	std::lock_guard<std::mutex> lock(statsMutex);
+	currentStats = stats;
+	LOG_INFO("Trajectory played: {} of {} setpoints, {} late writes, jitter mean {:.3f} ms, max {:.3f} ms",
+		stats.sent, stats.total, stats.late, stats.meanJitter * 1000.0, stats.maxJitter * 1000.0);
+	for (auto& device : stats.devices) {
+		LOG_INFO("    odrv{}: {} late, {} failed, jitter mean {:.3f} ms, max {:.3f} ms",
+			device.odriveID, device.late, device.failed, device.meanJitter * 1000.0, device.maxJitter * 1000.0);
+	}
+}
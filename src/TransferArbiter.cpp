@@ -0,0 +1,36 @@
+
+#include "pch.h"
+#include "TransferArbiter.h"
+
+void TransferArbiter::acquire(TransferPriority priority) {
+	std::unique_lock<std::mutex> lock(mutex);
+	size_t lane = (size_t)priority;
+
+	waiting[lane]++;
+	wakeups[lane].wait(lock, [&] { return !busy && !higherWaiting(priority); });
+	waiting[lane]--;
+	busy = true;
+}
+
+bool TransferArbiter::tryAcquire(TransferPriority priority) {
+	std::lock_guard<std::mutex> lock(mutex);
+	if (busy || higherWaiting(priority))
+		return false;
+
+	busy = true;
+	return true;
+}
+
+void TransferArbiter::release() {
+	std::lock_guard<std::mutex> lock(mutex);
+	busy = false;
+
+	// Only the most important waiting class may go next. All of its waiters are woken, the first
+	// one to get the mutex takes the link and the others go back to sleep.
+	for (size_t lane = 0; lane < (size_t)TransferPriority::COUNT; lane++) {
+		if (waiting[lane] > 0) {
+			wakeups[lane].notify_all();
+			return;
+		}
+	}
+}
@@ -0,0 +1,116 @@
+
+#include "pch.h"
+#include "VerifiedWriter.h"
+
+// The device consumes these right away and resets them, so only the ack can be checked
+static bool IsCommandEndpoint(const BasicEndpoint& endpoint) {
+	return endpoint.name == "requested_state";
+}
+
+void VerifiedWriter::write(const BasicEndpoint& endpoint, const EndpointValue& value) {
+
+	std::lock_guard<std::mutex> lock(mutex);
+	DeviceQueue& queue = queues[endpoint.odriveID];
+
+	auto it = std::find_if(queue.writes.begin(), queue.writes.end(), [&](const PendingWrite& w) { return w.endpoint.id == endpoint.id; });
+	if (it != queue.writes.end()) {
+		it->value = value;
+	}
+	else {
+		queue.writes.push_back({ endpoint, value, Battery::GetRuntime() });
+	}
+
+	if (!queue.scheduled) {
+		queue.scheduled = true;
+		pool.submit([this, odriveID = endpoint.odriveID] { flush(odriveID); });
+	}
+}
+
+std::optional<WriteVerification> VerifiedWriter::recentResult(EndpointHandle handle) const {
+	std::lock_guard<std::mutex> lock(mutex);
+	auto it = results.find(handle);
+	if (it == results.end() || Battery::GetRuntime() - it->second.timestamp > VERIFY_RESULT_DURATION)
+		return std::nullopt;
+
+	return it->second;
+}
+
+void VerifiedWriter::flush(int odriveID) {
+
+	TransferPriorityScope priority(TransferPriority::INTERACTIVE);
+
+	while (true) {
+		std::vector<PendingWrite> writes;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			DeviceQueue& queue = queues[odriveID];
+			if (queue.writes.empty()) {
+				queue.scheduled = false;
+				return;
+			}
+			std::swap(writes, queue.writes);
+		}
+
+		auto odrive = registry.get(odriveID);
+		std::vector<WriteVerification> verifications(writes.size());
+		RequestBatch batch;
+		std::vector<size_t> writeRequests;
+		std::vector<size_t> readRequests;
+
+		for (auto& write : writes) {
+			BasicEndpoint* endpoint = odrive ? odrive->findEndpoint(write.endpoint.identifier) : nullptr;
+			if (!endpoint) {
+				writeRequests.push_back(SIZE_MAX);
+				continue;
+			}
+			write.value = write.value.as(endpoint->type);		// Send it with the type the device expects
+			writeRequests.push_back(batch.addWrite(*endpoint, write.value, true));
+		}
+		for (size_t i = 0; i < writes.size(); i++) {
+			readRequests.push_back(writeRequests[i] != SIZE_MAX ? batch.addRead(*odrive->findEndpoint(writes[i].endpoint.identifier)) : SIZE_MAX);
+		}
+
+		if (odrive && !batch.empty()) {
+			odrive->transact(batch);
+		}
+
+		double now = Battery::GetRuntime();
+		for (size_t i = 0; i < writes.size(); i++) {
+			WriteVerification& v = verifications[i];
+			v.endpoint = writes[i].endpoint;
+			v.written = writes[i].value;
+			v.timestamp = now;
+			v.latency = now - writes[i].requested;
+
+			if (writeRequests[i] == SIZE_MAX) {
+				LOG_ERROR("Verified write to {} failed: Endpoint is not available", v.endpoint.fullPath);
+				continue;
+			}
+
+			v.acknowledged = batch.results[writeRequests[i]].type() != EndpointValueType::INVALID;
+			v.readBack = batch.results[readRequests[i]];
+			v.success = v.acknowledged && (v.readBack == v.written || IsCommandEndpoint(v.endpoint));
+
+			if (v.success) {
+				LOG_DEBUG("Verified {} = {} after {:.1f} ms", v.endpoint.fullPath, v.readBack.toString(), v.latency * 1000.0);
+			}
+			else if (v.readBack.type() == EndpointValueType::INVALID) {
+				LOG_ERROR("Verified write to {} failed: No read-back", v.endpoint.fullPath);
+			}
+			else {
+				LOG_WARN("Verified write mismatch: Wrote {} to {}, but it reads {}", v.written.toString(), v.endpoint.fullPath, v.readBack.toString());
+			}
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			for (auto& v : verifications) {
+				results[v.endpoint.handle()] = v;
+			}
+		}
+
+		if (callback) {
+			callback(verifications);
+		}
+	}
+}
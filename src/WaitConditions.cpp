@@ -0,0 +1,86 @@
+
+#include "pch.h"
+#include "WaitConditions.h"
+#include "RequestBatch.h"
+
+Task<std::vector<WaitResult>> WaitForConditions(AsyncExecutor& executor, const DeviceRegistry& registry, std::vector<WaitCondition> conditions) {
+
+	double start = Battery::GetRuntime();
+	std::vector<WaitResult> results(conditions.size());
+	std::vector<bool> pending(conditions.size(), true);
+	size_t pendingCount = conditions.size();
+	double interval = WAIT_INITIAL_INTERVAL;
+
+	while (pendingCount > 0) {
+
+		// One job per device, reading all of its pending conditions
+		std::map<int, std::vector<size_t>> batches;
+		for (size_t i = 0; i < conditions.size(); i++) {
+			if (pending[i]) {
+				batches[conditions[i].odriveID].push_back(i);
+			}
+		}
+
+		std::vector<EndpointValue> values(conditions.size());
+		std::vector<std::function<void()>> jobs;
+		for (auto& [odriveID, indices] : batches) {
+			auto odrive = registry.get(odriveID);
+			if (!odrive)
+				continue;
+
+			jobs.push_back([&, odrive, indices = indices] {
+				TransferPriorityScope priority(TransferPriority::POLL);
+				RequestBatch batch;
+				std::vector<std::pair<size_t, size_t>> reads;		// Condition, request index
+				for (size_t i : indices) {
+					auto endpoint = odrive->findEndpoint(conditions[i].identifier);
+					if (endpoint) {
+						reads.emplace_back(i, batch.addRead(*endpoint));
+					}
+				}
+
+				odrive->transact(batch);		// Failed reads stay invalid, the others are still used
+				for (auto& [i, request] : reads) {
+					values[i] = batch.results[request];
+				}
+			});
+		}
+		co_await executor.all(std::move(jobs));
+
+		// Evaluate
+		double now = Battery::GetRuntime();
+		bool progress = false;
+		for (size_t i = 0; i < conditions.size(); i++) {
+			if (!pending[i])
+				continue;
+
+			if (values[i].type() != EndpointValueType::INVALID) {
+				results[i].lastValue = values[i];
+			}
+
+			bool met = values[i].type() != EndpointValueType::INVALID && conditions[i].predicate(values[i]);
+			if (met || now - start >= conditions[i].timeout || !registry.get(conditions[i].odriveID)) {
+				results[i].met = met;
+				results[i].elapsed = now - start;
+				pending[i] = false;
+				pendingCount--;
+				progress = true;
+			}
+		}
+
+		if (pendingCount == 0)
+			break;
+
+		// Back off while nothing happens, but never sleep past the next deadline
+		interval = progress ? WAIT_INITIAL_INTERVAL : std::min(interval * WAIT_BACKOFF_FACTOR, WAIT_MAX_INTERVAL);
+		double nextDeadline = std::numeric_limits<double>::max();
+		for (size_t i = 0; i < conditions.size(); i++) {
+			if (pending[i]) {
+				nextDeadline = std::min(nextDeadline, start + conditions[i].timeout);
+			}
+		}
+		co_await executor.sleep(std::max(std::min(interval, nextDeadline - now), 0.0));
+	}
+
+	co_return results;
+}
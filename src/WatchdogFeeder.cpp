@@ -0,0 +1,190 @@
+
+#include "pch.h"
+#include "WatchdogFeeder.h"
+
+WatchdogFeeder::~WatchdogFeeder() {
+	stop();
+}
+
+bool WatchdogFeeder::start(const std::vector<WatchdogAxis>& axes, double period) {
+
+	if (isRunning || period <= 0.0)
+		return false;
+
+	devices.clear();
+	axisStatus.clear();
+	for (const WatchdogAxis& axis : axes) {
+		auto odrive = registry.get(axis.odriveID);
+		if (!odrive)
+			continue;
+
+		std::string path = "axis" + std::to_string(axis.axis) + ".";
+		auto feed = odrive->functions.find(path + "watchdog_feed");
+		auto error = odrive->findEndpoint(path + "error");
+		auto enabled = odrive->findEndpoint(path + "config.enable_watchdog");
+		auto timeout = odrive->findEndpoint(path + "config.watchdog_timeout");
+		if (feed == odrive->functions.end() || !error || !enabled || !timeout) {
+			LOG_WARN("odrv{}: {} has no watchdog", axis.odriveID, path);
+			continue;
+		}
+
+		AxisStatus status;
+		status.axis = axis;
+		if (odrive->readValue(*enabled).toDouble() != 0.0) {
+			status.timeout = odrive->readValue(*timeout).toDouble();
+		}
+		if (status.timeout <= 0.0) {
+			LOG_WARN("odrv{}: The watchdog of axis{} is disabled, it is fed anyway", axis.odriveID, axis.axis);
+		}
+		else if (period > status.timeout * WATCHDOG_ALARM_FRACTION / 2.0) {
+			LOG_WARN("odrv{}: Feeding every {:.0f} ms is too slow for the {:.0f} ms watchdog timeout of axis{}",
+				axis.odriveID, period * 1000.0, status.timeout * 1000.0, axis.axis);
+		}
+
+		auto device = std::find_if(devices.begin(), devices.end(), [&](auto& d) { return d->odrive == odrive; });
+		if (device == devices.end()) {
+			devices.push_back(std::make_unique<Device>());
+			devices.back()->odrive = odrive;
+			device = devices.end() - 1;
+		}
+		(*device)->batch.addCall(feed->second->basic);
+		(*device)->axes.emplace_back(axisStatus.size(), (*device)->batch.addRead(*error));
+		status.lastFeed = Battery::GetRuntime();
+		axisStatus.push_back(status);
+	}
+
+	if (devices.empty())
+		return false;
+
+	feedPeriod = period;
+	monitorInterval = period / 2.0;
+	for (const AxisStatus& status : axisStatus) {
+		if (status.timeout > 0.0) {
+			monitorInterval = std::min(monitorInterval, status.timeout * WATCHDOG_ALARM_FRACTION / 4.0);
+		}
+	}
+	jitterHistogram = std::make_unique<LatencyHistogram>();
+	currentStats = Stats();
+	jitterSum = 0.0;
+
+	isRunning = true;
+	for (auto& device : devices) {
+		device->thread = std::thread(&WatchdogFeeder::feedLoop, this, std::ref(*device));
+	}
+	monitor = std::thread(&WatchdogFeeder::monitorLoop, this);
+
+	LOG_INFO("Feeding {} watchdogs on {} devices every {:.1f} ms", axisStatus.size(), devices.size(), period * 1000.0);
+	return true;
+}
+
+void WatchdogFeeder::stop() {
+
+	if (!isRunning)
+		return;
+
+	isRunning = false;
+	for (auto& device : devices) {
+		if (device->thread.joinable()) {
+			device->thread.join();
+		}
+	}
+	if (monitor.joinable()) {
+		monitor.join();
+	}
+
+	Stats stats = this->stats();
+	LOG_INFO("Watchdog feeding stopped after {} ticks, jitter mean {:.3f} ms, max {:.3f} ms",
+		stats.ticks, stats.meanJitter * 1000.0, stats.maxJitter * 1000.0);
+}
+
+std::vector<WatchdogFeeder::AxisStatus> WatchdogFeeder::status() const {
+	std::lock_guard<std::mutex> lock(statusMutex);
+	return axisStatus;
+}
+
+WatchdogFeeder::Stats WatchdogFeeder::stats() const {
+	std::lock_guard<std::mutex> lock(statusMutex);
+	return currentStats;
+}
+
+void WatchdogFeeder::feedLoop(Device& device) {
+
+	TransferPriorityScope priority(TransferPriority::SAFETY);
+	using clock = std::chrono::steady_clock;
+	auto period = std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(feedPeriod));
+	auto spin = std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(WATCHDOG_SPIN_TIME));
+	auto nextFeed = clock::now() - period;		// The first feed goes out right away
+	double runtimeOffset = Battery::GetRuntime() - std::chrono::duration<double>(clock::now().time_since_epoch()).count();
+
+	while (isRunning) {
+
+		// Absolute schedule, a late feed does not delay the following ones
+		nextFeed += period;
+		auto now = clock::now();
+		if (nextFeed < now - period) {
+			nextFeed = now;
+		}
+		std::this_thread::sleep_until(nextFeed - spin);
+		while (clock::now() < nextFeed);
+
+		device.odrive->transact(device.batch);
+
+		// Jitter reaches up to the moment the device handled the feeds, so waiting for the link or
+		// a slow transfer counts as well. Unconfirmed feeds are timed by when they were sent.
+		double scheduled = std::chrono::duration<double>(nextFeed.time_since_epoch()).count() + runtimeOffset;
+		double handled = device.batch.sent;
+		for (auto& [index, request] : device.axes) {
+			if (device.batch.results[request].type() != EndpointValueType::INVALID) {
+				handled = std::max(handled, device.batch.times[request].sampled);
+			}
+		}
+		double jitter = std::max(handled - scheduled, 0.0);		// The clocks were read a moment apart
+		jitterHistogram->record(jitter);
+
+		std::lock_guard<std::mutex> lock(statusMutex);
+		currentStats.ticks++;
+		jitterSum += jitter;
+		currentStats.meanJitter = jitterSum / currentStats.ticks;
+		currentStats.maxJitter = std::max(currentStats.maxJitter, jitter);
+
+		for (auto& [index, request] : device.axes) {
+			AxisStatus& status = axisStatus[index];
+			const EndpointValue& error = device.batch.results[request];
+			if (error.type() == EndpointValueType::INVALID) {
+				status.failed++;
+				continue;
+			}
+
+			// The error is read right after the feed, so its response confirms the feed
+			double fed = device.batch.times[request].sampled;
+			status.maxGap = std::max(status.maxGap, fed - status.lastFeed);
+			status.lastFeed = fed;
+			status.feeds++;
+
+			bool expired = ((int64_t)error.toDouble() & AxisError::AXIS_ERROR_WATCHDOG_TIMER_EXPIRED) != 0;
+			if (expired && !status.expired) {
+				LOG_ERROR("odrv{}: The watchdog of axis{} expired", status.axis.odriveID, status.axis.axis);
+			}
+			status.expired = expired;
+		}
+	}
+}
+
+void WatchdogFeeder::monitorLoop() {
+
+	while (isRunning) {
+		std::this_thread::sleep_for(std::chrono::duration<double>(monitorInterval));
+
+		double now = Battery::GetRuntime();
+		std::lock_guard<std::mutex> lock(statusMutex);
+		for (AxisStatus& status : axisStatus) {
+			double age = now - status.lastFeed;
+			bool alarm = status.timeout > 0.0 && age > status.timeout * WATCHDOG_ALARM_FRACTION;
+			if (alarm && !status.alarm) {
+				LOG_ERROR("odrv{}: The watchdog of axis{} was last fed {:.0f} ms ago, it expires after {:.0f} ms",
+					status.axis.odriveID, status.axis.axis, age * 1000.0, status.timeout * 1000.0);
+			}
+			status.alarm = alarm;
+		}
+	}
+}